@@ -0,0 +1,244 @@
+#pragma once
+#include "CountingSort.h"
+#include "NaturalMergeSort.h"
+#include "PdqSort.h"
+#include "RadixSort.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace adaptive {
+
+enum class Strategy { Insertion, Counting, Radix, NaturalMerge, Pdq };
+
+inline const char* to_string(Strategy s) {
+    switch (s) {
+        case Strategy::Insertion: return "insertion";
+        case Strategy::Counting: return "counting";
+        case Strategy::Radix: return "radix";
+        case Strategy::NaturalMerge: return "natural-merge";
+        case Strategy::Pdq: return "pdqsort";
+    }
+    return "?";
+}
+
+constexpr size_t kInsertionMax = 32;
+constexpr size_t kBlock = 64;          // contiguous elements per scanned block
+constexpr size_t kScanDivisor = 32;    // scan about n / kScanDivisor elements...
+constexpr size_t kMinScan = 1 << 9;    // ...but at least this many
+constexpr size_t kMaxScan = 1 << 15;   // ...and at most this many
+constexpr size_t kInversionPoints = 128;
+constexpr size_t kKeySample = 512;     // entropy sample: n / 16 elements, at most this many
+constexpr size_t kRadixMin = 1 << 12;
+
+// Estimates from evenly spaced blocks. Run boundaries inside the blocks
+// estimate the number of monotone runs; inversions between the first
+// elements of the blocks measure global disorder (0 sorted, ~0.5 random,
+// 1 reversed); a sorted subsample gives the key range and the entropy of
+// the key distribution.
+template <typename T>
+struct Profile {
+    double runs{1};
+    double inversionRate{0};
+    double entropyBits{0};  // extrapolated to n for keys that look unique
+    T lo{};
+    T hi{};
+};
+
+template <typename T, typename Compare>
+Profile<T> profile(const T* a, size_t n, Compare& cmp, SortWorkspace* ws = nullptr) {
+    Profile<T> p;
+    size_t len = std::min(kBlock, n);
+    size_t blocks = std::max<size_t>(1, std::min(std::max(n / kScanDivisor, kMinScan), kMaxScan) / len);
+    size_t stride = blocks > 1 ? (n - len) / (blocks - 1) : 0;
+    // Blocks are jittered inside their stride so periodic input (fixed-size
+    // runs, sawtooth) cannot hide its run boundaries between them.
+    Scratch<size_t> starts(ws, blocks);
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t slack = b + 1 < blocks && stride > len ? stride - len : 0;
+        starts[b] = b * stride + (slack ? static_cast<size_t>((b + 1) * 0x9E3779B97F4A7C15ull >> 33) % slack : 0);
+    }
+
+    size_t breaks = 0;
+    for (size_t b = 0; b < blocks; ++b) {
+        const T* blk = a + starts[b];
+        for (size_t i = natural::run_length(blk, len, cmp); i < len; ++breaks) {
+            i += natural::run_length(blk + i, len - i, cmp);
+        }
+    }
+    p.runs = 1.0 + static_cast<double>(breaks) * static_cast<double>(n - 1) /
+                       static_cast<double>(blocks * (len - 1));
+    // No run boundary in the sample: the input is a few long runs and
+    // natural merge wins outright, so the rest of the profile is skipped.
+    if (breaks == 0) return p;
+
+    size_t step = std::max<size_t>(1, blocks / kInversionPoints);
+    size_t pairs = 0, inversions = 0;
+    for (size_t i = 0; i < blocks; i += step) {
+        for (size_t j = i + step; j < blocks; j += step) {
+            inversions += cmp(a[starts[j]], a[starts[i]]);
+            ++pairs;
+        }
+    }
+    p.inversionRate = pairs ? static_cast<double>(inversions) / static_cast<double>(pairs) : 0.0;
+
+    // Keys seen once in the sample stand for keys that are (nearly) unique
+    // in the input, which contribute log2(n) rather than log2(sample) bits.
+    const size_t m = std::min(kKeySample, std::max<size_t>(n / 16, kInsertionMax));
+    Scratch<T> sample(ws, m);
+    ops::scratch(m * sizeof(T));
+    ops::moved(m, sizeof(T));
+    for (size_t i = 0; i < m; ++i) sample[i] = a[i * (n / m) + (i * 7919) % (n / m)];
+    pdq::sort(sample.data(), sample.data() + m, cmp);
+    const double s = static_cast<double>(m);
+    double singles = 0;
+    for (size_t i = 0; i < m;) {
+        size_t j = i + 1;
+        while (j < m && !cmp(sample[i], sample[j])) ++j;
+        double c = static_cast<double>(j - i);
+        p.entropyBits -= c / s * std::log2(c / s);
+        if (j - i == 1) ++singles;
+        i = j;
+    }
+    p.entropyBits += singles / s * std::max(0.0, std::log2(static_cast<double>(n) / s));
+    p.lo = sample[0];
+    p.hi = sample[m - 1];
+    return p;
+}
+
+// Rough per-element costs in ns, calibrated against single-threaded runs
+// of the generator patterns; only their ratios matter.
+constexpr double kMergeLevelNs = 4.5;   // one merge level over randomly interleaved runs
+constexpr double kScanNs = 0.5;         // run detection
+constexpr double kPdqLevelNs = 1.6;     // one partitioning level
+constexpr double kRadixPassNs = 1.6;    // one scatter pass, plus kRadixByteNs per key byte
+constexpr double kRadixByteNs = 0.2;
+constexpr double kRadixCacheBytes = 4 << 20;  // scatter passes cost about twice as much beyond this
+constexpr double kCountNs = 2.0;        // min/max and histogram passes
+constexpr double kCountSlotNs = 1.0;    // per histogram slot per element
+
+inline double merge_cost(double runs) {
+    return kScanNs + kMergeLevelNs * std::ceil(std::log2(std::max(1.0, runs)));
+}
+
+// pdqsort needs about one level per bit of key entropy, and far fewer on
+// nearly sorted or nearly reversed input.
+inline double pdq_cost(double entropyBits, double inversionRate) {
+    double disorder = std::min(inversionRate, 1.0 - inversionRate);
+    return kPdqLevelNs * std::max(1.0, entropyBits) * std::min(1.0, 0.1 + 4.0 * disorder);
+}
+
+// One histogram pass plus one scatter per digit below the highest byte
+// that differs between the smallest and largest key.
+template <typename T>
+double radix_cost(const T& lo, const T& hi, size_t n) {
+    auto diff = RadixKey<T>::bits(lo) ^ RadixKey<T>::bits(hi);
+    int passes = 0;
+    while (diff) {
+        ++passes;
+        diff >>= 8;
+    }
+    double pass = kRadixPassNs + kRadixByteNs * static_cast<double>(sizeof(T));
+    if (static_cast<double>(n * sizeof(T)) > kRadixCacheBytes) pass *= 2;
+    return (1 + passes) * pass;
+}
+
+template <typename T>
+double range_per_element(T lo, T hi, size_t n) {
+    using U = typename std::make_unsigned<T>::type;
+    return (static_cast<double>(static_cast<U>(hi) - static_cast<U>(lo)) + 1.0) / static_cast<double>(n);
+}
+
+}
+
+// Profiles a sample of the input and runs whichever of natural merge,
+// counting, radix and pdqsort the cost model rates cheapest. Counting and
+// radix sort are only candidates when they order keys the way Compare
+// does. The decision and the profile behind it are reported via note().
+// The cost model is calibrated single-threaded, so counting and radix sort
+// run on one thread unless `threads` says otherwise (0 = every CPU).
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class AdaptiveSorter final : public Sorter<T, Compare> {
+public:
+    explicit AdaptiveSorter(unsigned threads = 1, Compare cmp = Compare())
+        : Sorter<T, Compare>(cmp), threads_(threads) {}
+
+    std::string name() const override { return "Adaptive"; }
+    bool parallel() const override { return resolve_threads(threads_) > 1; }
+    std::string note() const override { return note_; }
+
+    void sort(std::vector<T>& a) override {
+        T* p = a.data();
+        const size_t n = a.size();
+        if (n <= adaptive::kInsertionMax) {
+            detail::insertion_sort(p, n, this->cmp_);
+            record(adaptive::Strategy::Insertion, nullptr);
+            return;
+        }
+
+        const adaptive::Profile<T> prof = adaptive::profile(p, n, this->cmp_, this->workspace_);
+        const adaptive::Strategy s = choose(prof, n);
+        switch (s) {
+            case adaptive::Strategy::Counting:
+                if constexpr (std::is_integral<T>::value) counting::sort(p, n, threads_, this->workspace_);
+                break;
+            case adaptive::Strategy::Radix:
+                if constexpr (radix_compatible<T, Compare>::value) radix::sort(p, n, threads_, this->workspace_);
+                break;
+            case adaptive::Strategy::NaturalMerge:
+                natural::sort(p, n, this->cmp_, this->workspace_);
+                break;
+            default:
+                pdq::sort(p, p + n, this->cmp_);
+                break;
+        }
+        record(s, &prof);
+    }
+
+private:
+    adaptive::Strategy choose(const adaptive::Profile<T>& prof, size_t n) {
+        using adaptive::Strategy;
+        if (prof.runs < 2) return Strategy::NaturalMerge;
+        Strategy best = Strategy::NaturalMerge;
+        double bestCost = adaptive::merge_cost(prof.runs);
+        auto consider = [&](Strategy s, double cost) {
+            if (cost < bestCost) {
+                best = s;
+                bestCost = cost;
+            }
+        };
+        consider(Strategy::Pdq, adaptive::pdq_cost(prof.entropyBits, prof.inversionRate));
+
+        if constexpr (radix_compatible<T, Compare>::value) {
+            if (n >= adaptive::kRadixMin) consider(Strategy::Radix, adaptive::radix_cost(prof.lo, prof.hi, n));
+        }
+        if constexpr (std::is_integral<T>::value && radix_compatible<T, Compare>::value) {
+            double slots = adaptive::range_per_element(prof.lo, prof.hi, n);
+            // The sample range is only a hint, but counting::sort finds the
+            // exact one and falls back to bucketing when it is too wide.
+            if (slots <= 1.0) consider(Strategy::Counting, adaptive::kCountNs + adaptive::kCountSlotNs * slots);
+        }
+        return best;
+    }
+
+    void record(adaptive::Strategy s, const adaptive::Profile<T>* prof) {
+        char buf[128];
+        if (!prof || prof->runs < 2) {
+            note_ = adaptive::to_string(s);
+            if (prof) note_ += ": presorted";
+            return;
+        }
+        std::snprintf(buf, sizeof(buf), "%s: runs~%.0f inv=%.2f entropy=%.1f bits",
+                      adaptive::to_string(s), prof->runs, prof->inversionRate, prof->entropyBits);
+        note_ = buf;
+    }
+
+    unsigned threads_;
+    std::string note_;
+};
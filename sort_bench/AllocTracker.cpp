@@ -0,0 +1,198 @@
+#include "AllocTracker.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Totals since startup; the region baselines below are taken from these.
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_bytes{0};
+std::atomic<size_t> g_live{0};
+std::atomic<size_t> g_peak{0};
+
+struct Region {
+    uint64_t allocations{0};
+    uint64_t bytes{0};
+    size_t live{0};
+    bool rss{false};
+    uint64_t rssBytes{0};
+};
+
+Region g_region;
+
+#if defined(__linux__)
+
+// Value in kB of `field` (e.g. "VmRSS:") in /proc/self/status, read
+// without allocating so the lookup does not show up in the counts.
+bool status_kb(const char* field, uint64_t& kb) {
+    int fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    char buf[4096];
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return false;
+    buf[len] = '\0';
+    const char* p = std::strstr(buf, field);
+    if (!p) return false;
+    kb = std::strtoull(p + std::strlen(field), nullptr, 10);
+    return true;
+}
+
+// Sets the kernel's peak-RSS mark back to the current RSS (Linux 4.0+).
+bool reset_peak_rss() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+#endif
+
+}
+
+namespace alloc {
+
+void begin() {
+    Region r;
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+#if defined(__linux__)
+    uint64_t kb = 0;
+    r.rss = reset_peak_rss() && status_kb("VmRSS:", kb);
+    r.rssBytes = kb << 10;
+#endif
+    r.allocations = g_allocations.load(std::memory_order_relaxed);
+    r.bytes = g_bytes.load(std::memory_order_relaxed);
+    r.live = g_live.load(std::memory_order_relaxed);
+    g_peak.store(r.live, std::memory_order_relaxed);
+    g_region = r;
+}
+
+Usage end() {
+    const Region& r = g_region;
+    Usage u;
+    u.measured = true;
+    u.allocations = g_allocations.load(std::memory_order_relaxed) - r.allocations;
+    u.bytes = g_bytes.load(std::memory_order_relaxed) - r.bytes;
+    const size_t peak = g_peak.load(std::memory_order_relaxed);
+    u.peakHeapBytes = peak > r.live ? peak - r.live : 0;
+#if defined(__linux__)
+    uint64_t kb = 0;
+    if (r.rss && status_kb("VmHWM:", kb)) {
+        u.rss = true;
+        u.peakRssBytes = (kb << 10) > r.rssBytes ? (kb << 10) - r.rssBytes : 0;
+    }
+#endif
+    return u;
+}
+
+size_t live_bytes() { return g_live.load(std::memory_order_relaxed); }
+
+}
+
+#if SORT_BENCH_TRACK_ALLOC
+
+namespace {
+
+// Every block carries a header just below the pointer handed out: the
+// requested size, for the counts on delete, and the distance back to what
+// malloc returned. Over-allocating by the alignment keeps aligned new on
+// plain malloc/free, so all forms of delete free the same way.
+struct Header {
+    size_t size;
+    size_t offset;
+};
+
+constexpr size_t kMinAlign = alignof(std::max_align_t) > sizeof(Header) ? alignof(std::max_align_t) : sizeof(Header);
+
+void note_alloc(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t live = g_live.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = g_peak.load(std::memory_order_relaxed);
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+void* try_allocate(size_t size, size_t align) {
+    if (align < kMinAlign) align = kMinAlign;
+    const size_t extra = align == kMinAlign ? kMinAlign : align + sizeof(Header);
+    if (size > SIZE_MAX - extra) return nullptr;
+    char* base = static_cast<char*>(std::malloc(size + extra));
+    if (!base) return nullptr;
+    const uintptr_t first = reinterpret_cast<uintptr_t>(base) + sizeof(Header);
+    char* p = reinterpret_cast<char*>((first + align - 1) & ~uintptr_t(align - 1));
+    Header* h = reinterpret_cast<Header*>(p) - 1;
+    h->size = size;
+    h->offset = static_cast<size_t>(p - base);
+    note_alloc(size);
+    return p;
+}
+
+// operator new semantics: retry through the new-handler, then throw.
+void* allocate(size_t size, size_t align) {
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = try_allocate(size, align)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocate_nothrow(size_t size, size_t align) noexcept {
+    try {
+        return allocate(size, align);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void deallocate(void* p) noexcept {
+    if (!p) return;
+    const Header* h = static_cast<const Header*>(p) - 1;
+    g_live.fetch_sub(h->size, std::memory_order_relaxed);
+    std::free(static_cast<char*>(p) - h->offset);
+}
+
+}
+
+void* operator new(size_t size) { return allocate(size, 0); }
+void* operator new[](size_t size) { return allocate(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate_nothrow(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate_nothrow(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return allocate(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return allocate(size, static_cast<size_t>(al)); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate_nothrow(size, static_cast<size_t>(al));
+}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate_nothrow(size, static_cast<size_t>(al));
+}
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// AllocTracker.cpp replaces the global operator new and delete (every
+// form, including the sized, aligned and nothrow ones) with versions that
+// count what passes through them, so the runner can say how much heap a
+// sorter asks for. Build with -DSORT_BENCH_TRACK_ALLOC=0 to keep the
+// library's allocator, e.g. under a sanitizer that wants its own.
+//
+// Only operator new is seen: malloc from C code and SortWorkspace blocks
+// backed by mmap are not, though both show up in the resident set.
+#ifndef SORT_BENCH_TRACK_ALLOC
+#define SORT_BENCH_TRACK_ALLOC 1
+#endif
+
+namespace alloc {
+
+constexpr bool kEnabled = SORT_BENCH_TRACK_ALLOC != 0;
+
+// Memory use over one region between begin() and end(). Heap figures are
+// summed over all threads.
+struct Usage {
+    bool measured{false};       // set by end(); false when no region was measured
+    uint64_t allocations{0};
+    uint64_t bytes{0};          // requested through operator new
+    uint64_t peakHeapBytes{0};  // live heap high-water above the level at begin()
+    bool rss{false};            // peakRssBytes is valid (Linux only)
+    uint64_t peakRssBytes{0};   // resident-set high-water above the level at begin()
+};
+
+// Regions do not nest. begin() hands free heap pages back to the OS
+// (glibc) and resets the kernel's peak-RSS mark (VmHWM), so RSS growth
+// counts pages the region touches rather than ones the allocator had kept
+// resident. Both cost system calls and later page faults; keep begin() out
+// of timed code.
+void begin();
+Usage end();
+
+// Bytes currently live through operator new; 0 when tracking is off.
+size_t live_bytes();
+
+}
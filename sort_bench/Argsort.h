@@ -0,0 +1,243 @@
+#pragma once
+#include "PdqSort.h"
+#include "RadixSort.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Index permutations for sorting one key column and reordering the other
+// columns of the same rows (structure-of-arrays data). Keys are packed
+// with their row index into (key, index) pairs and the pairs are sorted
+// stably, so rows with equal keys keep their input order; the payload
+// columns are then reordered with gather(), one column per pass. Indices
+// are 32-bit, which limits inputs to 2^32 rows.
+namespace argsort {
+
+constexpr size_t kGatherPrefetch = 16;  // perm entries gather() looks ahead
+
+template <typename T>
+struct Pair {
+    T key;
+    uint32_t index;
+};
+
+template <typename Compare>
+struct PairByKey {
+    Compare cmp;
+    template <typename T>
+    bool operator()(const Pair<T>& a, const Pair<T>& b) const { return cmp(a.key, b.key); }
+};
+
+}
+
+template <typename T>
+struct RadixKey<argsort::Pair<T>> {
+    using Bits = typename RadixKey<T>::Bits;
+    static Bits bits(const argsort::Pair<T>& p) { return RadixKey<T>::bits(p.key); }
+};
+
+namespace argsort {
+
+// Packs keys[0, n) into `pairs` and sorts them stably: by radix sort when
+// its key order is Compare's, otherwise by merge sort on the keys.
+template <typename T, typename Compare>
+void sort_pairs(const T* keys, size_t n, Pair<T>* pairs, Compare& cmp, unsigned threads, SortWorkspace* ws) {
+    for (size_t i = 0; i < n; ++i) pairs[i] = {keys[i], static_cast<uint32_t>(i)};
+    ops::moved(n, sizeof(Pair<T>));
+    if constexpr (radix_compatible<T, Compare>::value) {
+        radix::sort(pairs, n, threads, ws);
+    } else {
+        Scratch<Pair<T>> tmp(ws, n);
+        ops::scratch(n * sizeof(Pair<T>));
+        PairByKey<Compare&> byKey{cmp};
+        detail::merge_sort_impl(pairs, tmp.data(), n, false, byKey);
+    }
+}
+
+// Fills perm[0, n) so that keys[perm[0]], keys[perm[1]], ... is in Compare
+// order, equal keys in input order. The keys are not modified.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+void argsort(const T* keys, size_t n, uint32_t* perm, Compare cmp = Compare(), unsigned threads = 0,
+             SortWorkspace* ws = nullptr) {
+    Scratch<Pair<T>> pairs(ws, n);
+    ops::scratch(n * sizeof(Pair<T>));
+    sort_pairs(keys, n, pairs.data(), cmp, threads, ws);
+    for (size_t i = 0; i < n; ++i) perm[i] = pairs[i].index;
+}
+
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+std::vector<uint32_t> argsort(const std::vector<T>& keys, Compare cmp = Compare(), unsigned threads = 0,
+                              SortWorkspace* ws = nullptr) {
+    std::vector<uint32_t> perm(keys.size());
+    argsort(keys.data(), keys.size(), perm.data(), cmp, threads, ws);
+    return perm;
+}
+
+// Stable sort of keys[0, n) that also fills perm with the permutation it
+// applied, for reordering payload columns with gather(). Unlike argsort,
+// the sorted keys are written back straight from the pairs, which saves
+// a gather of the key column.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+void sort_by_key(T* keys, size_t n, uint32_t* perm, Compare cmp = Compare(), unsigned threads = 0,
+                 SortWorkspace* ws = nullptr) {
+    Scratch<Pair<T>> pairs(ws, n);
+    ops::scratch(n * sizeof(Pair<T>));
+    sort_pairs(keys, n, pairs.data(), cmp, threads, ws);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = pairs[i].key;
+        perm[i] = pairs[i].index;
+    }
+    ops::moved(n, sizeof(T) + sizeof(uint32_t));
+}
+
+// dst[i] = src[perm[i]]. The writes are sequential and the random reads
+// are prefetched kGatherPrefetch rows ahead, so several misses are in
+// flight at once instead of one per row.
+template <typename V>
+void gather(const V* src, const uint32_t* perm, size_t n, V* dst) {
+    size_t i = 0;
+#if defined(__GNUC__)
+    for (; i + kGatherPrefetch < n; ++i) {
+        __builtin_prefetch(src + perm[i + kGatherPrefetch]);
+        dst[i] = src[perm[i]];
+    }
+#endif
+    for (; i < n; ++i) dst[i] = src[perm[i]];
+    ops::moved(n, sizeof(V));
+}
+
+// Reorders column[0, n) in place by perm, through a scratch copy.
+template <typename V>
+void permute(V* column, const uint32_t* perm, size_t n, SortWorkspace* ws = nullptr) {
+    Scratch<V> tmp(ws, n);
+    ops::scratch(n * sizeof(V));
+    gather(column, perm, n, tmp.data());
+    std::move(tmp.data(), tmp.data() + n, column);
+    ops::moved(n, sizeof(V));
+}
+
+// Indirect sorting of rows held as an array of structs: a narrow array
+// that refers to the rows is sorted in their place, and the rows are then
+// moved once, by gather, into sorted order. Index and Pointer sort the
+// references with pdqsort, so every comparison loads two rows at random;
+// KeyIndex copies each key next to its row index and radix sorts those
+// pairs, so the rows are read only to extract the keys and to gather.
+enum class Indirect { Index, Pointer, KeyIndex };
+
+inline const char* to_string(Indirect how) {
+    switch (how) {
+        case Indirect::Index: return "index";
+        case Indirect::Pointer: return "pointer";
+        case Indirect::KeyIndex: return "key+index";
+    }
+    return "?";
+}
+
+template <typename T, typename Compare>
+struct IndexByRow {
+    const T* rows;
+    Compare cmp;
+    bool operator()(uint32_t a, uint32_t b) const { return cmp(rows[a], rows[b]); }
+};
+
+template <typename T, typename Compare>
+struct PointerByRow {
+    Compare cmp;
+    bool operator()(const T* a, const T* b) const { return cmp(*a, *b); }
+};
+
+// dst[i] = *ptrs[i], prefetched like gather().
+template <typename T>
+void gather_pointers(const T* const* ptrs, size_t n, T* dst) {
+    size_t i = 0;
+#if defined(__GNUC__)
+    for (; i + kGatherPrefetch < n; ++i) {
+        __builtin_prefetch(ptrs[i + kGatherPrefetch]);
+        dst[i] = *ptrs[i];
+    }
+#endif
+    for (; i < n; ++i) dst[i] = *ptrs[i];
+    ops::moved(n, sizeof(T));
+}
+
+// Sorts rows[0, n) through `how`, comparing with cmp, which is Compare or
+// its counting wrapper. KeyIndex needs keys whose radix order is Compare's
+// and falls back to Index otherwise.
+template <typename T, typename Compare, typename Counted>
+void sort_indirect(T* rows, size_t n, Indirect how, Counted& cmp, unsigned threads = 0,
+                   SortWorkspace* ws = nullptr) {
+    Scratch<T> out(ws, n);
+    ops::scratch(n * sizeof(T));
+    if (how == Indirect::Pointer) {
+        Scratch<const T*> ptrs(ws, n);
+        ops::scratch(n * sizeof(const T*));
+        for (size_t i = 0; i < n; ++i) ptrs[i] = rows + i;
+        ops::moved(n, sizeof(const T*));
+        PointerByRow<T, Counted&> byRow{cmp};
+        pdq::sort(ptrs.data(), ptrs.data() + n, byRow);
+        gather_pointers(ptrs.data(), n, out.data());
+    } else {
+        Scratch<uint32_t> perm(ws, n);
+        ops::scratch(n * sizeof(uint32_t));
+        bool sorted = false;
+        if constexpr (radix_compatible<T, Compare>::value) {
+            if (how == Indirect::KeyIndex) {
+                using Bits = typename RadixKey<T>::Bits;
+                Scratch<Pair<Bits>> pairs(ws, n);
+                ops::scratch(n * sizeof(Pair<Bits>));
+                for (size_t i = 0; i < n; ++i) pairs[i] = {RadixKey<T>::bits(rows[i]), static_cast<uint32_t>(i)};
+                ops::moved(n, sizeof(Pair<Bits>));
+                radix::sort(pairs.data(), n, threads, ws);
+                for (size_t i = 0; i < n; ++i) perm[i] = pairs[i].index;
+                ops::moved(n, sizeof(uint32_t));
+                sorted = true;
+            }
+        }
+        if (!sorted) {
+            for (size_t i = 0; i < n; ++i) perm[i] = static_cast<uint32_t>(i);
+            ops::moved(n, sizeof(uint32_t));
+            IndexByRow<T, Counted&> byRow{rows, cmp};
+            pdq::sort(perm.data(), perm.data() + n, byRow);
+        }
+        gather(rows, perm.data(), n, out.data());
+    }
+    std::copy(out.data(), out.data() + n, rows);
+    ops::moved(n, sizeof(T));
+}
+
+}
+
+// Rows sorted through argsort::sort_indirect and written back in sorted
+// order, so the result is checked like any in-place sort.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class IndirectSorter final : public Sorter<T, Compare> {
+public:
+    explicit IndirectSorter(argsort::Indirect how, Compare cmp = Compare()) : Sorter<T, Compare>(cmp), how_(how) {}
+
+    std::string name() const override { return std::string("indirect ") + argsort::to_string(how_); }
+    bool parallel() const override { return how_ == argsort::Indirect::KeyIndex && resolve_threads(0) > 1; }
+
+    bool supports(const std::vector<T>& a, std::string& reason) const override {
+        if (how_ == argsort::Indirect::KeyIndex && !radix_compatible<T, Compare>::value) {
+            reason = "keys are not radix-sortable";
+            return false;
+        }
+        if (how_ != argsort::Indirect::Pointer && a.size() > std::numeric_limits<uint32_t>::max()) {
+            reason = "more than 2^32 rows";
+            return false;
+        }
+        reason.clear();
+        return true;
+    }
+
+    void sort(std::vector<T>& a) override {
+        argsort::sort_indirect<T, Compare>(a.data(), a.size(), how_, this->cmp_, 0, this->workspace_);
+    }
+
+private:
+    argsort::Indirect how_;
+};
@@ -0,0 +1,237 @@
+#include "BenchmarkRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+// The CPUs the calling thread may run on.
+static bool get_affinity(std::vector<int>& cpus) {
+    cpus.clear();
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return false;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set)) cpus.push_back(c);
+    }
+#elif defined(_WIN32)
+    DWORD_PTR process = 0, system = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) return false;
+    for (int c = 0; c < static_cast<int>(8 * sizeof(DWORD_PTR)); ++c) {
+        if (process & (DWORD_PTR(1) << c)) cpus.push_back(c);
+    }
+#endif
+    return !cpus.empty();
+}
+
+static bool set_affinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c < 0 || c >= CPU_SETSIZE) return false;
+        CPU_SET(c, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int c : cpus) {
+        if (c < 0 || c >= static_cast<int>(8 * sizeof(DWORD_PTR))) return false;
+        mask |= DWORD_PTR(1) << c;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+static double percentile_sorted(const std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    double pos = p * static_cast<double>(v.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, v.size() - 1);
+    double frac = pos - static_cast<double>(lo);
+    return v[lo] + (v[hi] - v[lo]) * frac;
+}
+
+// 0-based rank r such that [x(r), x(n-1-r)] of n sorted samples holds the
+// median with at least 95% probability: the largest r with
+// P(Binomial(n, 1/2) <= r) <= 0.025. Below 6 samples no r qualifies and
+// the whole range is used.
+static size_t median_ci_rank(size_t n) {
+    if (n > 1000) {
+        const double r = std::floor(0.5 * (static_cast<double>(n) - 1.96 * std::sqrt(static_cast<double>(n)))) - 1;
+        return static_cast<size_t>(std::max(0.0, r));
+    }
+    double pmf = std::pow(0.5, static_cast<double>(n));  // P(B == 0)
+    double cdf = pmf;
+    size_t r = 0;
+    while (r + 1 < n / 2) {
+        pmf *= static_cast<double>(n - r) / static_cast<double>(r + 1);  // P(B == r + 1)
+        if (cdf + pmf > 0.025) break;
+        cdf += pmf;
+        ++r;
+    }
+    return r;
+}
+
+RunStats compute_stats(std::vector<double> samplesNs) {
+    RunStats s;
+    s.samples = static_cast<int>(samplesNs.size());
+    if (samplesNs.empty()) return s;
+
+    std::sort(samplesNs.begin(), samplesNs.end());
+    s.minNs = samplesNs.front();
+    s.medianNs = percentile_sorted(samplesNs, 0.5);
+    s.p90Ns = percentile_sorted(samplesNs, 0.9);
+
+    double sum = 0.0;
+    for (double x : samplesNs) sum += x;
+    s.meanNs = sum / static_cast<double>(samplesNs.size());
+
+    if (samplesNs.size() > 1) {
+        double sq = 0.0;
+        for (double x : samplesNs) sq += (x - s.meanNs) * (x - s.meanNs);
+        s.stddevNs = std::sqrt(sq / static_cast<double>(samplesNs.size() - 1));
+
+        const size_t r = median_ci_rank(samplesNs.size());
+        s.ciHalfWidthNs = std::max(s.medianNs - samplesNs[r], samplesNs[samplesNs.size() - 1 - r] - s.medianNs);
+
+        std::vector<double> dev(samplesNs.size());
+        for (size_t i = 0; i < dev.size(); ++i) dev[i] = std::abs(samplesNs[i] - s.medianNs);
+        std::sort(dev.begin(), dev.end());
+        s.madNs = percentile_sorted(dev, 0.5);
+    }
+    return s;
+}
+
+double predict_ns(const std::vector<TimingPoint>& points, size_t n, bool quadratic) {
+    if (points.empty() || n == 0) return 0.0;
+    const TimingPoint& hi = points.back();
+    const double ratio = static_cast<double>(n) / static_cast<double>(hi.n);
+    if (points.size() == 1 || ratio <= 1.0) {
+        if (quadratic) return hi.ns * ratio * ratio;
+        if (hi.n < 2 || n < 2) return hi.ns * ratio;
+        return hi.ns * ratio * std::log2(static_cast<double>(n)) / std::log2(static_cast<double>(hi.n));
+    }
+    // Fixed costs flatten the curve at small sizes, so slopes below linear
+    // are taken as linear.
+    const TimingPoint& lo = points[points.size() - 2];
+    double exponent = 1.0;
+    if (lo.ns > 0 && hi.ns > 0) {
+        exponent = std::log(hi.ns / lo.ns) / std::log(static_cast<double>(hi.n) / static_cast<double>(lo.n));
+        exponent = std::min(3.0, std::max(1.0, exponent));
+    }
+    return hi.ns * std::pow(ratio, exponent);
+}
+
+BenchmarkRunner::BenchmarkRunner(BenchConfig cfg) : cfg_(cfg) {
+    if (cfg_.pinCpu >= 0) {
+        // Only checked here; run() pins around each sequential sorter, so
+        // threads started in between keep every CPU the process has.
+        pinned_ = get_affinity(unpinned_) && set_affinity({cfg_.pinCpu}) && set_affinity(unpinned_);
+        if (!pinned_) {
+            std::cerr << "warning: could not pin to CPU " << cfg_.pinCpu << ", running unpinned\n";
+        }
+    }
+    if (cfg_.perfCounters) {
+        perf_ = std::make_unique<PerfCounters>();
+        if (!perf_->available()) {
+            std::cerr << "warning: " << perf_->status() << ", reporting time only\n";
+            perf_.reset();
+        } else if (!perf_->status().empty()) {
+            std::cerr << "note: " << perf_->status() << "\n";
+        }
+    }
+}
+
+void BenchmarkRunner::pinCaller(bool pin) const {
+    set_affinity(pin ? std::vector<int>{cfg_.pinCpu} : unpinned_);
+}
+
+void BenchmarkRunner::planRuns(BenchResult& r, int& warmup, int& minRuns, int& maxRuns) const {
+    if (cfg_.cellBudgetSec <= 0 || r.predictedNs <= 0) return;
+    const double budgetNs = cfg_.cellBudgetSec * 1e9;
+    if (r.predictedNs > budgetNs) {
+        r.skipped = true;
+        r.extrapolated = true;
+        std::ostringstream reason;
+        reason << std::fixed << std::setprecision(1) << "~" << r.predictedNs / 1e9 << " s per run predicted, over the "
+               << std::defaultfloat << cfg_.cellBudgetSec << " s cell budget";
+        r.reason = reason.str();
+        return;
+    }
+    const int fit = static_cast<int>(budgetNs / r.predictedNs);
+    if (fit >= warmup + minRuns) return;
+    r.capped = true;
+    minRuns = std::min(minRuns, std::max(1, warmup > 0 ? fit - 1 : fit));
+    warmup = std::min(warmup, fit - minRuns);
+    maxRuns = minRuns;
+}
+
+void BenchmarkRunner::record(const std::string& key, size_t n, double medianNs) {
+    if (medianNs <= 0) return;
+    std::vector<TimingPoint>& points = history_[key];
+    auto it = std::lower_bound(points.begin(), points.end(), n,
+                               [](const TimingPoint& p, size_t v) { return p.n < v; });
+    if (it != points.end() && it->n == n) it->ns = medianNs;
+    else points.insert(it, {n, medianNs});
+}
+
+bool BenchmarkRunner::enoughSamples(const std::vector<double>& samplesNs, Clock::time_point start, int minRuns,
+                                    int maxRuns) const {
+    const int n = static_cast<int>(samplesNs.size());
+    if (n < minRuns) return false;
+    if (n >= maxRuns) return true;
+    if (Clock::now() - start >= std::chrono::duration<double>(cfg_.timeBudgetSec)) return true;
+    if (n < 2) return false;
+
+    RunStats s = compute_stats(samplesNs);
+    return s.medianNs > 0 && s.ciHalfWidthNs / s.medianNs <= cfg_.ciTarget;
+}
+
+void BenchmarkRunner::finish(BenchResult& r, std::vector<double> samplesNs) const {
+    r.samplesNs = samplesNs;
+    r.stats = compute_stats(std::move(samplesNs));
+    r.nsPerElement = r.n == 0 ? 0.0 : r.stats.medianNs / static_cast<double>(r.n);
+    if (!r.verified) r.reason = "output mismatch";
+}
+
+void BenchmarkRunner::finishPerf(BenchResult& r, const std::vector<PerfSample>& samples) const {
+    if (samples.empty() || r.n == 0) return;
+    const double n = static_cast<double>(r.n);
+
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        return percentile_sorted(v, 0.5);
+    };
+
+    std::vector<double> v;
+    for (size_t e = 0; e < kPerfEvents; ++e) {
+        v.clear();
+        for (const PerfSample& s : samples) {
+            if (s.valid[e]) v.push_back(s.value[e]);
+        }
+        if (v.size() != samples.size()) continue;
+        r.perf.perElement.value[e] = median(v) / n;
+        r.perf.perElement.valid[e] = true;
+        r.perf.available = true;
+    }
+
+    v.clear();
+    for (const PerfSample& s : samples) {
+        if (s.has(PerfEvent::Cycles) && s.has(PerfEvent::Instructions) && s[PerfEvent::Cycles] > 0) {
+            v.push_back(s[PerfEvent::Instructions] / s[PerfEvent::Cycles]);
+        }
+    }
+    if (v.size() == samples.size()) r.perf.ipc = median(v);
+}
@@ -0,0 +1,280 @@
+#pragma once
+#include "AllocTracker.h"
+#include "PerfCounters.h"
+#include "Sorter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+struct BenchConfig {
+    int repeats{3};             // minimum number of timed runs per sorter
+    int maxRepeats{200};
+    int warmup{1};              // untimed runs first; at least one, which measures memory
+    double ciTarget{0.02};      // stop once the 95% CI of the median is within this fraction of it
+    double timeBudgetSec{2.0};  // per sorter, including warmup and input copies
+    double cellBudgetSec{10.0}; // hard cap on one sorter at one size, from predicted run time (0 = none)
+    int pinCpu{-1};             // sequential sorters run on this CPU; -1 = leave affinity alone
+    bool perfCounters{true};    // read hardware counters around each timed run when available
+};
+
+struct RunStats {
+    int samples{0};
+    double minNs{0};
+    double medianNs{0};
+    double p90Ns{0};
+    double meanNs{0};
+    double stddevNs{0};
+    double madNs{0};            // median absolute deviation from the median
+    // Wider side of the distribution-free 95% CI of the median, between
+    // two order statistics, so one preempted run does not widen it.
+    double ciHalfWidthNs{0};
+};
+
+// Medians over the timed runs, per element sorted.
+struct PerfSummary {
+    bool available{false};
+    double ipc{0};              // median of instructions / cycles; 0 if either is missing
+    PerfSample perElement;
+};
+
+struct BenchResult {
+    std::string sorter;
+    size_t n{0};
+    bool skipped{false};
+    bool extrapolated{false};   // skipped because one run is predicted to exceed the cell budget
+    bool capped{false};         // fewer warmup or timed runs than configured, to fit the cell budget
+    double predictedNs{0};      // predicted time of one run; 0 without earlier results to predict from
+    std::string reason;
+    std::string note;           // ISorterT::note() after the last run
+    bool verified{false};
+    RunStats stats;
+    std::vector<double> samplesNs;  // timed runs in run order, for comparing against a baseline
+    double nsPerElement{0};
+    PerfSummary perf;
+    ops::Counts ops;            // last timed run; SORT_BENCH_COUNT_OPS builds only
+    alloc::Usage mem;           // first warmup run; not measured when the cell budget allows no warmup
+};
+
+RunStats compute_stats(std::vector<double> samplesNs);
+
+// Median time of one sorter at one size.
+struct TimingPoint {
+    size_t n;
+    double ns;
+};
+
+// Predicted time of one run at n from earlier points, sorted by n: a power
+// law through the two largest, its exponent clamped to [1, 3]. A single
+// point is extrapolated as n^2 for quadratic sorters and n log n
+// otherwise. 0 when there are no points.
+double predict_ns(const std::vector<TimingPoint>& points, size_t n, bool quadratic);
+
+// Order-independent digest of the element bytes; equal digests before and
+// after sorting mean the output is (with high probability) a permutation.
+template <typename T>
+uint64_t multiset_digest(const T* a, size_t n) {
+    static_assert(std::is_trivially_copyable<T>::value, "digest reads object bytes");
+    uint64_t sum = 0;
+    for (const T* x = a; x != a + n; ++x) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(x);
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (size_t off = 0; off < sizeof(T); off += 8) {
+            uint64_t w = 0;
+            std::memcpy(&w, p + off, std::min<size_t>(8, sizeof(T) - off));
+            h ^= w;
+            h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+            h ^= h >> 31;
+        }
+        sum += h;
+    }
+    return sum;
+}
+
+template <typename T>
+uint64_t multiset_digest(const std::vector<T>& a) {
+    return multiset_digest(a.data(), a.size());
+}
+
+class BenchmarkRunner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit BenchmarkRunner(BenchConfig cfg);
+
+    template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+    std::vector<BenchResult> run(const std::vector<T>& input,
+                                 const std::vector<std::unique_ptr<ISorterT<T>>>& sorters,
+                                 Compare cmp = Compare()) {
+        return run(input.data(), input.size(), sorters, cmp);
+    }
+
+    // Input that is not in a vector, e.g. a mapped dataset file. Each run
+    // copies input[0, n) into the working vector, and supports() sees that
+    // copy.
+    template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+    std::vector<BenchResult> run(const T* input, size_t n,
+                                 const std::vector<std::unique_ptr<ISorterT<T>>>& sorters,
+                                 Compare cmp = Compare());
+
+    // Run times are predicted from the same sorter's earlier results in the
+    // current series, for the same element type. Sweeps start a series per
+    // pattern, so a sorter that degrades on one pattern is predicted from
+    // its times on that pattern.
+    void setSeries(std::string label) { series_ = std::move(label); }
+
+    const BenchConfig& config() const { return cfg_; }
+    bool pinned() const { return pinned_; }
+    bool perfCounters() const { return perf_ != nullptr; }
+
+private:
+    static constexpr size_t kProbeSize = 4096;  // prefix a sorter with no history is first timed on
+
+    // Pins the calling thread to cfg_.pinCpu, or restores the CPUs it had.
+    void pinCaller(bool pin) const;
+
+    template <typename T, typename Compare>
+    BenchResult runOne(ISorterT<T>& sorter, const T* input, size_t n,
+                       uint64_t inputDigest, Compare& cmp);
+
+    // Fits the cell budget: marks r extrapolated when one run does not fit,
+    // otherwise lowers warmup and minRuns and sets maxRuns to what fits,
+    // keeping one warmup run for the memory measurement if two runs fit.
+    void planRuns(BenchResult& r, int& warmup, int& minRuns, int& maxRuns) const;
+    void record(const std::string& key, size_t n, double medianNs);
+
+    // True once the sample set meets the CI target or a repeat/time limit.
+    bool enoughSamples(const std::vector<double>& samplesNs, Clock::time_point start, int minRuns,
+                       int maxRuns) const;
+    void finish(BenchResult& r, std::vector<double> samplesNs) const;
+    void finishPerf(BenchResult& r, const std::vector<PerfSample>& samples) const;
+
+    BenchConfig cfg_;
+    bool pinned_{false};
+    std::vector<int> unpinned_;  // the caller's CPUs before pinning
+    std::unique_ptr<PerfCounters> perf_;  // null when disabled or unavailable
+    std::string series_;
+    std::map<std::string, std::vector<TimingPoint>> history_;  // by element type, series and sorter
+};
+
+template <typename T, typename Compare>
+std::vector<BenchResult> BenchmarkRunner::run(const T* input, size_t n,
+                                              const std::vector<std::unique_ptr<ISorterT<T>>>& sorters,
+                                              Compare cmp) {
+    const uint64_t digest = multiset_digest(input, n);
+
+    std::vector<BenchResult> results;
+    results.reserve(sorters.size());
+    for (const auto& s : sorters) {
+        const bool pin = pinned_ && !s->parallel();
+        if (pin) pinCaller(true);
+        results.push_back(runOne(*s, input, n, digest, cmp));
+        if (pin) pinCaller(false);
+    }
+    return results;
+}
+
+template <typename T, typename Compare>
+BenchResult BenchmarkRunner::runOne(ISorterT<T>& sorter, const T* input, size_t n,
+                                    uint64_t inputDigest, Compare& cmp) {
+    BenchResult r;
+    r.sorter = sorter.name();
+    r.n = n;
+
+    // The working copy keeps its capacity across repeats, so refilling it
+    // before each run is a plain memcpy outside the timed region.
+    std::vector<T> work(input, input + n);
+    if (!sorter.supports(work, r.reason)) {
+        r.skipped = true;
+        if (r.reason.empty()) r.reason = "input not supported";
+        return r;
+    }
+
+    // A sorter seen for the first time in this series at a large size is
+    // timed once on a prefix, so there is something to predict from even
+    // when no smaller size ran first.
+    const std::string key = std::string(typeid(T).name()) + "/" + series_ + "/" + r.sorter;
+    std::vector<TimingPoint>& points = history_[key];
+    if (cfg_.cellBudgetSec > 0 && points.empty() && n > kProbeSize) {
+        std::vector<T> probe(input, input + kProbeSize);
+        std::string unsupported;
+        if (sorter.supports(probe, unsupported)) {
+            const auto t0 = Clock::now();
+            sorter.sort(probe);
+            record(key, kProbeSize, std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        }
+    }
+    r.predictedNs = predict_ns(points, n, sorter.quadratic());
+    int warmup = std::max(1, cfg_.warmup);  // the first one measures memory
+    int minRuns = cfg_.repeats;
+    int maxRuns = std::max(cfg_.repeats, cfg_.maxRepeats);
+    planRuns(r, warmup, minRuns, maxRuns);
+    if (r.skipped) return r;
+
+    const size_t k = sorter.prefix();
+    std::vector<T> expected;
+    if (k > 0 && k < n) {
+        expected.resize(k);
+        std::partial_sort_copy(input, input + n, expected.begin(), expected.end(), cmp);
+    }
+    auto verify = [&](const std::vector<T>& out) {
+        if (!expected.empty()) {
+            auto equivalent = [&](const T& x, const T& y) { return !cmp(x, y) && !cmp(y, x); };
+            return out.size() >= k && std::equal(expected.begin(), expected.end(), out.begin(), equivalent);
+        }
+        return std::is_sorted(out.begin(), out.end(), cmp) && multiset_digest(out) == inputDigest;
+    };
+
+    const auto start = Clock::now();
+
+    // Memory is measured on the first warmup run only, which is never
+    // timed: alloc::begin() trims the heap, so that run pays the page
+    // faults, and its RSS growth is what the sorter itself touches.
+    for (int i = 0; i < warmup; ++i) {
+        work.assign(input, input + n);
+        if (i > 0) {
+            sorter.sort(work);
+            continue;
+        }
+        alloc::begin();
+        sorter.sort(work);
+        r.mem = alloc::end();
+        r.verified = verify(work);
+    }
+
+    std::vector<double> samples;
+    std::vector<PerfSample> perfSamples;
+    PerfCounters* perf = sorter.keepsThreads() ? nullptr : perf_.get();
+    do {
+        work.assign(input, input + n);
+
+        ops::Counts before;
+        if constexpr (ops::kEnabled) before = ops::snapshot();
+        const bool first = warmup == 0 && samples.empty();
+        if (perf) perf->start();
+        auto t0 = Clock::now();
+        sorter.sort(work);
+        auto t1 = Clock::now();
+        PerfSample perfSample;
+        if (perf) perfSample = perf->stop();
+        if (perf) perfSamples.push_back(perfSample);
+        if constexpr (ops::kEnabled) r.ops = ops::snapshot() - before;
+
+        samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        if (first) r.verified = verify(work);
+    } while (!enoughSamples(samples, start, minRuns, maxRuns));
+    r.note = sorter.note();
+
+    finish(r, std::move(samples));
+    record(key, r.n, r.stats.medianNs);
+    finishPerf(r, perfSamples);
+    return r;
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include "Parallel.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// Counting sort for integer keys of any range. One pass finds the minimum
+// and maximum and keys are counted by their offset above the minimum.
+// When the range fits a dense histogram the output is rewritten straight
+// from the counts. Wider ranges with few distinct keys are counted in a
+// small hash table instead, and rewritten the same way. Otherwise keys
+// are distributed into buckets by the high bits of the offset and each
+// bucket is sorted the same way, with its own range, which ends in dense
+// counting within a few levels.
+namespace counting {
+
+constexpr size_t kDenseSlots = size_t(1) << 16;  // largest dense histogram, per chunk
+constexpr int kSparseBits = 14;                  // hash table of at most 2^kSparseBits keys per chunk, half full
+constexpr int kBucketBits = 11;                  // at most 2^kBucketBits buckets in the parallel pass
+constexpr size_t kLocalSlots = size_t(1) << 11;  // histogram size of the sequential levels
+constexpr int kLocalBits = 11;
+constexpr size_t kInsertionCutoff = 64;
+constexpr size_t kParallelMinChunk = 1 << 16;
+
+template <typename T>
+using Bits = typename std::make_unsigned<T>::type;
+
+template <typename T>
+inline Bits<T> offset(T x, T lo) {
+    return static_cast<Bits<T>>(static_cast<Bits<T>>(x) - static_cast<Bits<T>>(lo));
+}
+
+template <typename T>
+inline T value(T lo, size_t k) {
+    return static_cast<T>(static_cast<Bits<T>>(static_cast<Bits<T>>(lo) + static_cast<Bits<T>>(k)));
+}
+
+inline int bit_width(uint64_t x) {
+    int w = 0;
+    for (; x; x >>= 1) ++w;
+    return w;
+}
+
+// A plain loop rather than std::minmax_element, so it vectorizes; the
+// bounds are kept in locals, which cannot alias the input.
+template <typename T>
+void min_max(const T* a, size_t n, T& lo, T& hi) {
+    T l = a[0], h = a[0];
+    for (size_t i = 1; i < n; ++i) {
+        l = std::min(l, a[i]);
+        h = std::max(h, a[i]);
+    }
+    lo = l;
+    hi = h;
+    ops::compared(2 * n);
+}
+
+template <typename T>
+void insertion_sort(T* a, size_t n) {
+    ops::Counting<std::less<T>> lt;
+    detail::insertion_sort(a, n, lt);
+}
+
+// Counts the distinct keys of a[0, n) in an open-addressing table of
+// 2^bits slots (a zero count marks a free slot). Returns false as soon as
+// the table would be more than half full.
+template <typename T>
+bool count_sparse(const T* a, size_t n, int bits, T* keys, size_t* counts) {
+    const size_t mask = (size_t(1) << bits) - 1;
+    std::fill_n(counts, mask + 1, 0);
+    size_t distinct = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const T x = a[i];
+        size_t h = static_cast<size_t>((static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        while (counts[h] && keys[h] != x) h = (h + 1) & mask;
+        if (!counts[h]) {
+            if (++distinct > (mask + 1) / 2) return false;
+            keys[h] = x;
+        }
+        ++counts[h];
+    }
+    return true;
+}
+
+// Rewrites a[0, n) as keys[k] repeated start[k + 1] - start[k] times, for
+// k in [0, m), start[m] == n. Each chunk of output positions finds its
+// first key by binary search, so the chunks are written in parallel.
+template <typename T>
+void write_runs(T* a, size_t n, unsigned threads, const T* keys, const size_t* start, size_t m) {
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t) {
+        size_t k = static_cast<size_t>(std::upper_bound(start, start + m + 1, b) - start) - 1;
+        for (size_t i = b; i < e; ++k) {
+            const size_t end = std::min(e, start[k + 1]);
+            std::fill_n(a + i, end - i, keys[k]);
+            i = end;
+        }
+    }, kParallelMinChunk);
+    ops::moved(n, sizeof(T));
+}
+
+// Sequential step on a bucket in x; the result ends up in y if toY,
+// else in x. Levels alternate between the two buffers, as in radix
+// msd_sort, and dense counting writes straight to the destination.
+template <typename T>
+void sort_level(T* x, T* y, size_t n, bool toY) {
+    T* out = toY ? y : x;
+    T lo, hi;
+    min_max(x, n, lo, hi);
+    const uint64_t span = offset(hi, lo);
+    size_t cnt[kLocalSlots];
+
+    // Small buckets of the parallel pass usually have a small range too.
+    if (span < kLocalSlots && span < 4 * static_cast<uint64_t>(n)) {
+        std::fill_n(cnt, span + 1, 0);
+        for (size_t i = 0; i < n; ++i) ++cnt[offset(x[i], lo)];
+        for (size_t k = 0, i = 0; k <= span; i += cnt[k], ++k) std::fill_n(out + i, cnt[k], value(lo, k));
+        ops::moved(n, sizeof(T));
+        return;
+    }
+    if (n <= kInsertionCutoff) {
+        insertion_sort(x, n);
+        if (toY) {
+            std::memcpy(y, x, n * sizeof(T));
+            ops::moved(n, sizeof(T));
+        }
+        return;
+    }
+
+    const int bits = std::min(kLocalBits, bit_width(n));
+    const int shift = std::max(0, bit_width(span) - bits);
+    const size_t buckets = static_cast<size_t>(span >> shift) + 1;
+    std::fill_n(cnt, buckets, 0);
+    for (size_t i = 0; i < n; ++i) ++cnt[offset(x[i], lo) >> shift];
+    size_t start[kLocalSlots];
+    for (size_t k = 0, s = 0; k < buckets; s += cnt[k], ++k) start[k] = s;
+    for (size_t i = 0; i < n; ++i) y[start[offset(x[i], lo) >> shift]++] = x[i];
+    ops::moved(n, sizeof(T));
+
+    for (size_t k = 0, b = 0; k < buckets; b += cnt[k], ++k) {
+        if (cnt[k]) sort_level(y + b, x + b, cnt[k], !toY);
+    }
+}
+
+// Ascending sort of a[0, n). The min/max pass and the counting are
+// parallel over chunks with a private histogram or hash table each, and
+// counted keys are written back in parallel (write_runs), so these cases
+// take two reads and one write of the input. In the bucketed case one
+// parallel scatter distributes the keys (per-chunk offsets, as in radix
+// parallel_pass) and buckets are finished on a thread pool, largest
+// first. Scratch is borrowed from `ws` when one is given.
+template <typename T>
+void sort(T* a, size_t n, unsigned threads = 0, SortWorkspace* ws = nullptr) {
+    static_assert(std::is_integral<T>::value, "counting sort requires integer keys");
+    if (n <= kInsertionCutoff) {
+        insertion_sort(a, n);
+        return;
+    }
+
+    const size_t chunks = parallel_chunks(n, threads, kParallelMinChunk);
+    Scratch<T> bounds(ws, 2 * chunks);
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        min_max(a + b, e - b, bounds[2 * c], bounds[2 * c + 1]);
+    }, kParallelMinChunk);
+    T lo = bounds[0], hi = bounds[1];
+    for (size_t c = 1; c < chunks; ++c) {
+        lo = std::min(lo, bounds[2 * c]);
+        hi = std::max(hi, bounds[2 * c + 1]);
+    }
+    const uint64_t span = offset(hi, lo);
+    if (span == 0) return;
+
+    if (span < kDenseSlots && (span + 1) * chunks <= n) {
+        const size_t slots = static_cast<size_t>(span) + 1;
+        Scratch<size_t> hist(ws, chunks * slots);
+        Scratch<T> keys(ws, slots);
+        Scratch<size_t> start(ws, slots + 1);
+        ops::scratch((chunks + 1) * slots * sizeof(size_t) + slots * sizeof(T));
+        parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+            size_t* h = &hist[c * slots];
+            std::fill_n(h, slots, 0);
+            for (size_t i = b; i < e; ++i) ++h[offset(a[i], lo)];
+        }, kParallelMinChunk);
+
+        size_t sum = 0, m = 0;
+        for (size_t k = 0; k < slots; ++k) {
+            size_t total = 0;
+            for (size_t c = 0; c < chunks; ++c) total += hist[c * slots + k];
+            if (total == 0) continue;
+            keys[m] = value(lo, k);
+            start[m++] = sum;
+            sum += total;
+        }
+        start[m] = n;
+        write_runs(a, n, threads, keys.data(), start.data(), m);
+        return;
+    }
+
+    {
+        const int bits = std::min(kSparseBits, bit_width(n) + 1);
+        const size_t slots = size_t(1) << bits;
+        Scratch<T> keys(ws, chunks * slots);
+        Scratch<size_t> counts(ws, chunks * slots);
+        Scratch<bool> fits(ws, chunks);
+        ops::scratch(chunks * slots * (sizeof(T) + sizeof(size_t)));
+        parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+            fits[c] = count_sparse(a + b, e - b, bits, &keys[c * slots], &counts[c * slots]);
+        }, kParallelMinChunk);
+        if (std::all_of(fits.data(), fits.data() + chunks, [](bool f) { return f; })) {
+            // Gather every chunk's keys to the front of the tables, sort
+            // them and merge equal ones; the sums become run starts.
+            size_t m = 0;
+            for (size_t i = 0; i < chunks * slots; ++i) {
+                if (counts[i]) {
+                    keys[m] = keys[i];
+                    counts[m++] = counts[i];
+                }
+            }
+            Scratch<size_t> order(ws, m);
+            for (size_t i = 0; i < m; ++i) order[i] = i;
+            std::sort(order.data(), order.data() + m, [&](size_t x, size_t y) { return keys[x] < keys[y]; });
+            Scratch<T> sorted(ws, m);
+            Scratch<size_t> start(ws, m + 1);
+            size_t distinct = 0, sum = 0;
+            for (size_t i = 0; i < m; ++i) {
+                const size_t j = order[i];
+                if (distinct == 0 || sorted[distinct - 1] != keys[j]) {
+                    sorted[distinct] = keys[j];
+                    start[distinct++] = sum;
+                }
+                sum += counts[j];
+            }
+            start[distinct] = n;
+            write_runs(a, n, threads, sorted.data(), start.data(), distinct);
+            return;
+        }
+    }
+
+    const int bits = std::min(kBucketBits, std::max(1, bit_width(n) - 5));
+    const int shift = std::max(0, bit_width(span) - bits);
+    const size_t buckets = static_cast<size_t>(span >> shift) + 1;
+    Scratch<T> tmp(ws, n);
+    Scratch<size_t> hist(ws, chunks * buckets);
+    Scratch<size_t> cnt(ws, buckets);
+    Scratch<size_t> start(ws, buckets);
+    Scratch<size_t> order(ws, buckets);
+    ops::scratch(n * sizeof(T) + (chunks + 3) * buckets * sizeof(size_t));
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        size_t* h = &hist[c * buckets];
+        std::fill_n(h, buckets, 0);
+        for (size_t i = b; i < e; ++i) ++h[offset(a[i], lo) >> shift];
+    }, kParallelMinChunk);
+
+    size_t sum = 0, used = 0;
+    for (size_t k = 0; k < buckets; ++k) {
+        start[k] = sum;
+        for (size_t c = 0; c < chunks; ++c) {
+            const size_t m = hist[c * buckets + k];
+            hist[c * buckets + k] = sum;
+            sum += m;
+        }
+        cnt[k] = sum - start[k];
+        if (cnt[k]) order[used++] = k;
+    }
+
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        size_t* off = &hist[c * buckets];
+        for (size_t i = b; i < e; ++i) tmp[off[offset(a[i], lo) >> shift]++] = a[i];
+    }, kParallelMinChunk);
+    ops::moved(n, sizeof(T));
+
+    std::sort(order.data(), order.data() + used, [&](size_t x, size_t y) { return cnt[x] > cnt[y]; });
+    parallel_tasks(used, threads, [&](size_t i) {
+        const size_t k = order[i];
+        sort_level(tmp.data() + start[k], a + start[k], cnt[k], true);
+    });
+}
+
+}
+
+// Integer keys only, ascending order, any range.
+template <typename T>
+class CountingSorter final : public ISorterT<T> {
+    static_assert(std::is_integral<T>::value, "CountingSorter requires integer keys");
+
+public:
+    explicit CountingSorter(unsigned threads = 0) : threads_(threads) {}
+    std::string name() const override { return "Counting"; }
+    bool parallel() const override { return resolve_threads(threads_) > 1; }
+    void sort(std::vector<T>& a) override { counting::sort(a.data(), a.size(), threads_, this->workspace_); }
+
+private:
+    unsigned threads_;
+};
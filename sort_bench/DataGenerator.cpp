@@ -0,0 +1,292 @@
+#include "DataGenerator.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr uint64_t kGamma = 0x9E3779B97F4A7C15ull;
+
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Counter-based SplitMix64: element i of a stream is a pure function of
+// (seed, i), which is what makes chunked generation thread-count independent.
+struct CounterRng {
+    uint64_t base;
+    explicit CounterRng(uint64_t seed, uint64_t stream = 0) : base(mix64(seed ^ (stream * kGamma))) {}
+    uint64_t at(uint64_t i) const { return mix64(base + (i + 1) * kGamma); }
+};
+
+// Sequential SplitMix64, for the few places that need several draws per element.
+struct SplitMix {
+    uint64_t state;
+    uint64_t next() { return mix64(state += kGamma); }
+    double uniform01() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+inline uint64_t mulhi64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;  // GNU extension; keeps -Wpedantic quiet
+    return static_cast<uint64_t>((static_cast<u128>(a) * b) >> 64);
+#else
+    uint64_t aLo = a & 0xFFFFFFFFu, aHi = a >> 32;
+    uint64_t bLo = b & 0xFFFFFFFFu, bHi = b >> 32;
+    uint64_t mid1 = aHi * bLo + ((aLo * bLo) >> 32);
+    uint64_t mid2 = aLo * bHi + (mid1 & 0xFFFFFFFFu);
+    return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// Maps a 64-bit hash to [0, range); range == 0 stands for the full 2^64.
+inline uint64_t bounded(uint64_t h, uint64_t range) {
+    return range == 0 ? h : mulhi64(h, range);
+}
+
+// Rejection-inversion Zipf sampler (Hormann & Derflinger), O(1) per draw
+// and no table, so it works for ranges of any size.
+class ZipfSampler {
+public:
+    ZipfSampler(uint64_t n, double s) : n_(static_cast<double>(n)), s_(s) {
+        hX1_ = hIntegral(1.5) - 1.0;
+        hN_ = hIntegral(n_ + 0.5);
+        sParam_ = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    uint64_t sample(SplitMix& rng) const {
+        while (true) {
+            double u = hN_ + rng.uniform01() * (hX1_ - hN_);
+            double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1.0) k = 1.0;
+            else if (k > n_) k = n_;
+            if (k - x <= sParam_ || u >= hIntegral(k + 0.5) - h(k)) {
+                return static_cast<uint64_t>(k);
+            }
+        }
+    }
+
+private:
+    static double helper1(double x) {
+        return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+    static double helper2(double x) {
+        return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+    }
+    double h(double x) const { return std::exp(-s_ * std::log(x)); }
+    double hIntegral(double x) const {
+        double lx = std::log(x);
+        return helper2((1.0 - s_) * lx) * lx;
+    }
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - s_);
+        if (t < -1.0) t = -1.0;
+        return std::exp(helper1(t) * x);
+    }
+
+    double n_;
+    double s_;
+    double hX1_;
+    double hN_;
+    double sParam_;
+};
+
+}
+
+const char* to_string(DataPattern p) {
+    switch (p) {
+        case DataPattern::Random:       return "random";
+        case DataPattern::Sorted:       return "sorted";
+        case DataPattern::Reversed:     return "reversed";
+        case DataPattern::NearlySorted: return "nearly-sorted";
+        case DataPattern::FewUnique:    return "few-unique";
+        case DataPattern::Zipf:         return "zipf";
+        case DataPattern::OrganPipe:    return "organ-pipe";
+        case DataPattern::Sawtooth:     return "sawtooth";
+        case DataPattern::SortedRuns:   return "sorted-runs";
+    }
+    return "unknown";
+}
+
+std::vector<DataPattern> all_patterns() {
+    return {DataPattern::Random, DataPattern::Sorted, DataPattern::Reversed,
+            DataPattern::NearlySorted, DataPattern::FewUnique, DataPattern::Zipf,
+            DataPattern::OrganPipe, DataPattern::Sawtooth, DataPattern::SortedRuns};
+}
+
+bool parse_pattern(const std::string& s, DataPattern& out) {
+    for (DataPattern p : all_patterns()) {
+        if (s == to_string(p)) {
+            out = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+
+template <typename T>
+std::vector<T> generate_impl(const DataGenConfig& cfg) {
+    const size_t n = cfg.n;
+    std::vector<T> a(n);
+    if (n == 0) return a;
+
+    const int64_t lo = cfg.minValue;
+    const uint64_t range = static_cast<uint64_t>(cfg.maxValue) - static_cast<uint64_t>(lo) + 1;
+    const CounterRng rng(cfg.seed);
+    auto key = [lo](uint64_t offset, size_t i) {
+        return KeyTraits<T>::make(lo + static_cast<int64_t>(offset), i);
+    };
+
+    // Evenly spaced ascending offsets across [0, range) over `len` positions.
+    const double span = range == 0 ? 18446744073709551616.0 : static_cast<double>(range);
+    auto ramp = [range, span](size_t i, size_t len) {
+        double f = static_cast<double>(i) / static_cast<double>(std::max<size_t>(1, len));
+        double off = f * span;
+        uint64_t last = range - 1;
+        return off >= static_cast<double>(last) ? last : static_cast<uint64_t>(off);
+    };
+    auto fill = [&](auto&& offsetAt) {
+        parallel_for(n, cfg.threads, [&](size_t b, size_t e, size_t) {
+            for (size_t i = b; i < e; ++i) a[i] = key(offsetAt(i), i);
+        });
+    };
+
+    switch (cfg.pattern) {
+        case DataPattern::Random:
+            fill([&](size_t i) { return bounded(rng.at(i), range); });
+            break;
+
+        case DataPattern::Sorted:
+        case DataPattern::NearlySorted:
+            fill([&](size_t i) { return ramp(i, n); });
+            break;
+
+        case DataPattern::Reversed:
+            fill([&](size_t i) { return ramp(n - 1 - i, n); });
+            break;
+
+        case DataPattern::FewUnique: {
+            const uint64_t k = std::max<size_t>(1, cfg.uniqueCount);
+            const CounterRng values(cfg.seed, 1);
+            fill([&](size_t i) {
+                uint64_t u = bounded(rng.at(i), k);
+                return bounded(values.at(u), range);
+            });
+            break;
+        }
+
+        case DataPattern::Zipf: {
+            const ZipfSampler zipf(range == 0 ? ~uint64_t{0} : range, cfg.zipfS);
+            fill([&](size_t i) {
+                SplitMix sm{rng.at(i)};
+                return zipf.sample(sm) - 1;
+            });
+            break;
+        }
+
+        case DataPattern::OrganPipe: {
+            const size_t half = (n + 1) / 2;
+            fill([&](size_t i) { return ramp(i < half ? i : n - 1 - i, half); });
+            break;
+        }
+
+        case DataPattern::Sawtooth: {
+            const size_t period = std::max<size_t>(1, cfg.period);
+            fill([&](size_t i) { return ramp(i % period, period); });
+            break;
+        }
+
+        case DataPattern::SortedRuns: {
+            // Runs are the unit of work, so each one is filled and sorted by a single thread.
+            const size_t len = std::max<size_t>(1, cfg.runLength);
+            const size_t runs = (n + len - 1) / len;
+            parallel_for(runs, cfg.threads, [&](size_t rb, size_t re, size_t) {
+                std::vector<uint64_t> offsets;
+                for (size_t r = rb; r < re; ++r) {
+                    size_t b = r * len;
+                    size_t e = std::min(n, b + len);
+                    offsets.clear();
+                    for (size_t i = b; i < e; ++i) offsets.push_back(bounded(rng.at(i), range));
+                    std::sort(offsets.begin(), offsets.end());
+                    for (size_t i = b; i < e; ++i) a[i] = key(offsets[i - b], i);
+                }
+            }, std::max<size_t>(1, (size_t{1} << 16) / len));
+            break;
+        }
+    }
+
+    if (cfg.pattern == DataPattern::NearlySorted) {
+        const size_t swaps = cfg.swaps ? cfg.swaps : std::max<size_t>(1, n / 100);
+        const CounterRng pick(cfg.seed, 2);
+        for (size_t k = 0; k < swaps; ++k) {
+            uint64_t h = pick.at(k);
+            size_t i = static_cast<size_t>(bounded(h, n));
+            size_t j = static_cast<size_t>(bounded(mix64(h), n));
+            std::swap(a[i], a[j]);
+        }
+    }
+
+    return a;
+}
+
+}
+
+uint64_t config_hash(const DataGenConfig& cfg) {
+    uint64_t zipfBits;
+    std::memcpy(&zipfBits, &cfg.zipfS, sizeof(zipfBits));
+    const uint64_t fields[] = {
+        cfg.n, static_cast<uint64_t>(cfg.minValue), static_cast<uint64_t>(cfg.maxValue),
+        static_cast<uint64_t>(cfg.pattern), cfg.seed, cfg.swaps, cfg.uniqueCount, zipfBits, cfg.period,
+        cfg.runLength, cfg.sharedPrefix, cfg.stringLength
+    };
+    uint64_t h = 0;
+    for (uint64_t f : fields) h = mix64(h + kGamma + f);
+    return h;
+}
+
+template <typename T>
+std::vector<T> DataGenerator::generate_as() const {
+    return generate_impl<T>(cfg_);
+}
+
+template std::vector<int32_t> DataGenerator::generate_as<int32_t>() const;
+template std::vector<int64_t> DataGenerator::generate_as<int64_t>() const;
+template std::vector<uint64_t> DataGenerator::generate_as<uint64_t>() const;
+template std::vector<float> DataGenerator::generate_as<float>() const;
+template std::vector<double> DataGenerator::generate_as<double>() const;
+template std::vector<Record> DataGenerator::generate_as<Record>() const;
+
+StringSet DataGenerator::generate_strings() const {
+    static const char kStem[] = "https://www.example.com/catalog/";
+    const size_t stemLength = sizeof(kStem) - 1;
+    const std::vector<int64_t> values = generate_as<int64_t>();
+    const uint64_t range = static_cast<uint64_t>(cfg_.maxValue) - static_cast<uint64_t>(cfg_.minValue);
+    size_t width = 1;
+    for (uint64_t r = range; r >= 36; r /= 36) ++width;
+    const size_t filler = cfg_.stringLength > width ? cfg_.stringLength - width : 0;
+
+    StringSet set;
+    set.reserve(values.size(), values.size() * (cfg_.sharedPrefix + width + filler));
+    std::string s;
+    for (int64_t v : values) {
+        s.clear();
+        for (size_t i = 0; i < cfg_.sharedPrefix; ++i) s.push_back(kStem[i % stemLength]);
+        uint64_t offset = static_cast<uint64_t>(v) - static_cast<uint64_t>(cfg_.minValue);
+        s.append(width, '0');
+        for (size_t i = 0; i < width; ++i, offset /= 36) {
+            s[s.size() - 1 - i] = "0123456789abcdefghijklmnopqrstuvwxyz"[offset % 36];
+        }
+        SplitMix sm{mix64(cfg_.seed ^ static_cast<uint64_t>(v))};
+        const size_t len = static_cast<size_t>(bounded(sm.next(), 2 * filler + 1));
+        for (size_t i = 0; i < len; ++i) s.push_back(static_cast<char>('a' + bounded(sm.next(), 26)));
+        set.add(s.data(), s.size());
+    }
+    return set;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "KeyTypes.h"
+#include "Strings.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class DataPattern {
+    Random,
+    Sorted,
+    Reversed,
+    NearlySorted,   // sorted, then `swaps` random pairs exchanged
+    FewUnique,      // `uniqueCount` distinct values
+    Zipf,           // rank-frequency skew with exponent `zipfS`
+    OrganPipe,      // ascending to the middle, then descending
+    Sawtooth,       // repeating ascending ramps of length `period`
+    SortedRuns      // concatenated independently sorted runs of length `runLength`
+};
+
+const char* to_string(DataPattern p);
+bool parse_pattern(const std::string& s, DataPattern& out);
+std::vector<DataPattern> all_patterns();
+
+struct DataGenConfig {
+    size_t n{0};
+    int64_t minValue{0};
+    int64_t maxValue{1000000};
+    DataPattern pattern{DataPattern::Random};
+    uint64_t seed{42};
+
+    size_t swaps{0};          // NearlySorted; 0 = n / 100
+    size_t uniqueCount{16};   // FewUnique
+    double zipfS{1.1};        // Zipf
+    size_t period{1000};      // Sawtooth
+    size_t runLength{1000};   // SortedRuns
+    size_t sharedPrefix{0};   // strings: leading bytes every string has in common
+    size_t stringLength{16};  // strings: mean length after the shared prefix
+    unsigned threads{0};      // 0 = hardware concurrency; does not affect the output
+};
+
+// Hash of every DataGenConfig field that affects the output (all but
+// threads), for naming and checking cached datasets.
+uint64_t config_hash(const DataGenConfig& cfg);
+
+// Every element is derived from (seed, index) with a counter-based hash, so
+// the output is identical for a given config regardless of thread count.
+class DataGenerator {
+public:
+    // Bump whenever the output for some config changes; cached datasets
+    // written by another version are regenerated.
+    static constexpr uint32_t kVersion = 1;
+
+    explicit DataGenerator(DataGenConfig cfg) : cfg_(cfg) {}
+
+    std::vector<int> generate() const { return generate_as<int>(); }
+
+    // Values are generated as int64 and converted with KeyTraits<T>::make.
+    // Instantiated for int32, int64, uint64, float, double and Record.
+    template <typename T>
+    std::vector<T> generate_as() const;
+
+    // One string per generated value: sharedPrefix bytes of a URL-like
+    // stem, the value as fixed-width base-36 digits, then lowercase filler
+    // derived from the value whose length brings the mean to stringLength.
+    // Equal values give equal strings and the string order is the value
+    // order, so every pattern means what it does for numbers.
+    StringSet generate_strings() const;
+
+    const DataGenConfig& config() const { return cfg_; }
+
+private:
+    DataGenConfig cfg_;
+};
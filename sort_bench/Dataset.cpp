@@ -0,0 +1,152 @@
+#include "Dataset.h"
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+
+FilePtr open_file(const std::string& path, const char* mode, std::string& error) {
+    FilePtr f(std::fopen(path.c_str(), mode), &std::fclose);
+    if (!f) error = "cannot open " + path + ": " + std::strerror(errno);
+    return f;
+}
+
+bool check_header(const std::string& path, const DatasetHeader& h, uint64_t fileBytes, std::string& error) {
+    if (std::memcmp(h.magic, kDatasetMagic, sizeof(h.magic)) != 0) {
+        error = path + " is not a dataset file";
+        return false;
+    }
+    if (h.format != kDatasetFormat) {
+        error = path + " has dataset format " + std::to_string(h.format) + ", expected " +
+                std::to_string(kDatasetFormat);
+        return false;
+    }
+    if (h.elementBytes == 0 || fileBytes != sizeof(DatasetHeader) + h.count * h.elementBytes) {
+        error = path + " is not " + std::to_string(h.count) + " elements of " + std::to_string(h.elementBytes) +
+                " bytes";
+        return false;
+    }
+    return true;
+}
+
+}
+
+bool read_dataset_header(const std::string& path, DatasetHeader& header, std::string& error) {
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(path, ec);
+    if (ec) {
+        error = "cannot stat " + path + ": " + ec.message();
+        return false;
+    }
+    FilePtr f = open_file(path, "rb", error);
+    if (!f) return false;
+    if (std::fread(&header, sizeof(header), 1, f.get()) != 1) {
+        error = path + " is too short for a dataset header";
+        return false;
+    }
+    return check_header(path, header, bytes, error);
+}
+
+bool write_dataset(const std::string& path, const char* key, size_t elementBytes, const void* data, size_t count,
+                   uint64_t generatorVersion, uint64_t configHash, std::string& error) {
+    DatasetHeader h{};
+    std::memcpy(h.magic, kDatasetMagic, sizeof(h.magic));
+    h.format = kDatasetFormat;
+    h.elementBytes = static_cast<uint32_t>(elementBytes);
+    std::strncpy(h.key, key, sizeof(h.key) - 1);
+    h.count = count;
+    h.generatorVersion = generatorVersion;
+    h.configHash = configHash;
+
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty()) std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        error = "cannot create " + dir.string() + ": " + ec.message();
+        return false;
+    }
+    const std::string tmp = path + ".tmp";
+    {
+        FilePtr f = open_file(tmp, "wb", error);
+        if (!f) return false;
+        const bool ok = std::fwrite(&h, sizeof(h), 1, f.get()) == 1 &&
+                        std::fwrite(data, elementBytes, count, f.get()) == count && std::fflush(f.get()) == 0;
+        if (!ok) {
+            error = "write error on " + tmp;
+            f.reset();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        error = "cannot rename " + tmp + " to " + path + ": " + ec.message();
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+    DatasetHeader h;
+    if (!read_dataset_header(path, h, error)) return false;
+    const size_t bytes = static_cast<size_t>(sizeof(DatasetHeader) + h.count * h.elementBytes);
+#if defined(__linux__)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    const int mapErrno = errno;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        error = "cannot map " + path + ": " + std::strerror(mapErrno);
+        return false;
+    }
+    base_ = p;
+    mapped_ = true;
+#else
+    FilePtr f = open_file(path, "rb", error);
+    if (!f) return false;
+    owned_.resize((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    if (std::fread(owned_.data(), 1, bytes, f.get()) != bytes) {
+        error = "short read on " + path;
+        owned_.clear();
+        return false;
+    }
+    base_ = owned_.data();
+#endif
+    bytes_ = bytes;
+    return true;
+}
+
+void MappedFile::close() {
+#if defined(__linux__)
+    if (mapped_) munmap(const_cast<void*>(base_), bytes_);
+#endif
+    owned_.clear();
+    owned_.shrink_to_fit();
+    base_ = nullptr;
+    bytes_ = 0;
+    mapped_ = false;
+}
+
+std::string DatasetCache::path(const char* key, const DataGenConfig& cfg) const {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(config_hash(cfg)));
+    const std::string name = std::string(key) + "-" + to_string(cfg.pattern) + "-n" + std::to_string(cfg.n) + "-v" +
+                             std::to_string(DataGenerator::kVersion) + "-" + hash + ".sbd";
+    return (std::filesystem::path(dir_) / name).string();
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "DataGenerator.h"
+#include "KeyTypes.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Binary dataset files: a 64-byte header, then `count` elements as raw
+// native-endian bytes, so the file maps straight onto a T array. Generated
+// datasets record the generator version and config they came from; other
+// dumps, such as production keys converted offline, set both to 0 and are
+// fed to the benchmark with --dataset.
+struct DatasetHeader {
+    char magic[8];              // kDatasetMagic
+    uint32_t format;            // kDatasetFormat
+    uint32_t elementBytes;      // sizeof(T)
+    char key[16];               // key_name<T>(), NUL-padded
+    uint64_t count;
+    uint64_t generatorVersion;  // DataGenerator::kVersion; 0 = not generated
+    uint64_t configHash;        // config_hash() of the generating config; 0 = not generated
+    uint64_t reserved;
+};
+
+static_assert(sizeof(DatasetHeader) == 64, "elements start 64 bytes in, aligned for every key type");
+
+inline constexpr char kDatasetMagic[8] = {'S', 'B', 'D', 'A', 'T', 'A', '\0', '\0'};
+constexpr uint32_t kDatasetFormat = 1;
+
+// Reads and checks the header: magic, format, and a file size that matches
+// count elements.
+bool read_dataset_header(const std::string& path, DatasetHeader& header, std::string& error);
+
+// Writes the file next to `path` and renames it into place, so a reader
+// never sees a partial dataset. Creates the directory if needed.
+bool write_dataset(const std::string& path, const char* key, size_t elementBytes, const void* data, size_t count,
+                   uint64_t generatorVersion, uint64_t configHash, std::string& error);
+
+template <typename T>
+bool write_dataset(const std::string& path, const std::vector<T>& data, uint64_t generatorVersion,
+                   uint64_t configHash, std::string& error) {
+    return write_dataset(path, key_name<T>(), sizeof(T), data.data(), data.size(), generatorVersion, configHash,
+                         error);
+}
+
+// A dataset file held read-only in memory. On Linux it is mapped with
+// MAP_POPULATE, so the pages are read in before the first timed run
+// instead of faulting in during it; elsewhere the file is read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const DatasetHeader& header() const { return *static_cast<const DatasetHeader*>(base_); }
+    const void* elements() const { return static_cast<const unsigned char*>(base_) + sizeof(DatasetHeader); }
+
+private:
+    const void* base_{nullptr};
+    size_t bytes_{0};
+    bool mapped_{false};
+    std::vector<uint64_t> owned_;  // the file's bytes when it is read rather than mapped
+};
+
+// The elements of a dataset file whose key type is T.
+template <typename T>
+class Dataset {
+public:
+    bool open(const std::string& path, std::string& error) {
+        if (!file_.open(path, error)) return false;
+        const DatasetHeader& h = file_.header();
+        if (h.elementBytes != sizeof(T) || std::strncmp(h.key, key_name<T>(), sizeof(h.key)) != 0) {
+            const std::string key(h.key, std::find(h.key, h.key + sizeof(h.key), '\0'));
+            error = path + " holds " + key + " keys, not " + key_name<T>();
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    const T* data() const { return static_cast<const T*>(file_.elements()); }
+    size_t size() const { return static_cast<size_t>(file_.header().count); }
+
+private:
+    MappedFile file_;
+};
+
+// Generated datasets kept in a directory, one file per key type, config
+// and generator version, so large inputs are generated once.
+class DatasetCache {
+public:
+    explicit DatasetCache(std::string dir) : dir_(std::move(dir)) {}
+
+    std::string path(const char* key, const DataGenConfig& cfg) const;
+
+    // Opens what DataGenerator(cfg).generate_as<T>() returns, generating
+    // it into the cache first when no current file is there.
+    template <typename T>
+    bool load(const DataGenConfig& cfg, Dataset<T>& out, std::string& error) const {
+        const std::string file = path(key_name<T>(), cfg);
+        const uint64_t hash = config_hash(cfg);
+        DatasetHeader h;
+        std::string missing;
+        const bool current = read_dataset_header(file, h, missing) && h.generatorVersion == DataGenerator::kVersion &&
+                             h.configHash == hash && h.count == cfg.n && h.elementBytes == sizeof(T);
+        if (!current) {
+            const std::vector<T> data = DataGenerator(cfg).generate_as<T>();
+            if (!write_dataset(file, data, DataGenerator::kVersion, hash, error)) return false;
+        }
+        return out.open(file, error);
+    }
+
+private:
+    std::string dir_;
+};
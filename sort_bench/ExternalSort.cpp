@@ -0,0 +1,415 @@
+#include "ExternalSort.h"
+#include "BenchmarkRunner.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using FilePtr = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+constexpr size_t kKey = sizeof(int64_t);
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+FilePtr open_file(const std::string& path, const char* mode, std::string& error) {
+    FilePtr f(std::fopen(path.c_str(), mode), &std::fclose);
+    if (!f) error = "cannot open " + path + ": " + std::strerror(errno);
+    return f;
+}
+
+// Runs reads and writes one at a time, in submission order, on a
+// background thread, so the caller sorts or merges while I/O is in flight.
+// FIFO order is what makes buffer reuse safe: a read into a buffer
+// submitted after its write cannot start before that write finished.
+class IoThread {
+public:
+    IoThread() : worker_([this] { loop(); }) {}
+
+    ~IoThread() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+
+    std::future<size_t> submit(std::function<size_t()> job) {
+        std::packaged_task<size_t()> task(std::move(job));
+        std::future<size_t> done = task.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            jobs_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return done;
+    }
+
+    std::future<size_t> read(std::FILE* f, int64_t* dst, size_t count) {
+        return submit([=] { return std::fread(dst, kKey, count, f); });
+    }
+
+    std::future<size_t> write(std::FILE* f, const int64_t* src, size_t count) {
+        return submit([=] { return std::fwrite(src, kKey, count, f); });
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            std::packaged_task<size_t()> job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty()) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::packaged_task<size_t()>> jobs_;
+    bool stop_{false};
+    std::thread worker_;  // last, so it starts after the members it uses
+};
+
+// Sequential key stream over a run file: one block is consumed while the
+// next one is being read.
+class BlockReader {
+public:
+    BlockReader(FilePtr file, size_t blockKeys, IoThread& io)
+        : file_(std::move(file)), io_(io), blockKeys_(blockKeys) {
+        buf_[0].resize(blockKeys);
+        buf_[1].resize(blockKeys);
+        pending_ = io_.read(file_.get(), buf_[1].data(), blockKeys_);
+    }
+
+    ~BlockReader() {
+        if (pending_.valid()) pending_.wait();
+    }
+
+    bool next(int64_t& key) {
+        if (pos_ == len_ && !advance()) return false;
+        key = buf_[cur_][pos_++];
+        return true;
+    }
+
+    bool failed() const { return std::ferror(file_.get()) != 0; }
+
+private:
+    bool advance() {
+        if (!pending_.valid()) return false;
+        len_ = pending_.get();
+        cur_ ^= 1;
+        pos_ = 0;
+        if (len_ == 0) return false;
+        pending_ = io_.read(file_.get(), buf_[cur_ ^ 1].data(), blockKeys_);
+        return true;
+    }
+
+    FilePtr file_;
+    IoThread& io_;
+    size_t blockKeys_;
+    std::vector<int64_t> buf_[2];
+    std::future<size_t> pending_;
+    int cur_{0};
+    size_t pos_{0};
+    size_t len_{0};
+};
+
+// Key sink that fills one block while the previous one is being written.
+class BlockWriter {
+public:
+    BlockWriter(FilePtr file, size_t blockKeys, IoThread& io)
+        : file_(std::move(file)), io_(io), blockKeys_(blockKeys) {
+        buf_[0].resize(blockKeys);
+        buf_[1].resize(blockKeys);
+    }
+
+    ~BlockWriter() { wait(); }
+
+    void push(int64_t key) {
+        buf_[cur_][len_++] = key;
+        if (len_ == blockKeys_) flush();
+    }
+
+    // Writes everything pushed so far; false if any write came up short.
+    bool finish() {
+        flush();
+        wait();
+        return ok_ && std::fflush(file_.get()) == 0;
+    }
+
+private:
+    void flush() {
+        if (len_ == 0) return;
+        wait();
+        expected_ = len_;
+        pending_ = io_.write(file_.get(), buf_[cur_].data(), len_);
+        cur_ ^= 1;
+        len_ = 0;
+    }
+
+    void wait() {
+        if (pending_.valid()) ok_ = pending_.get() == expected_ && ok_;
+    }
+
+    FilePtr file_;
+    IoThread& io_;
+    size_t blockKeys_;
+    std::vector<int64_t> buf_[2];
+    std::future<size_t> pending_;
+    size_t expected_{0};
+    int cur_{0};
+    size_t len_{0};
+    bool ok_{true};
+};
+
+// Tournament tree over k sorted sources. Internal node i (1 <= i < k)
+// holds the loser of the match played there, node 0 the overall winner;
+// replacing the winner's key replays only its leaf-to-root path, one
+// comparison per level.
+class LoserTree {
+public:
+    explicit LoserTree(std::vector<BlockReader*> sources)
+        : src_(std::move(sources)), k_(src_.size()), key_(k_), live_(k_), tree_(std::max<size_t>(k_, 1)) {
+        for (size_t i = 0; i < k_; ++i) live_[i] = src_[i]->next(key_[i]);
+        if (k_ > 0) tree_[0] = build(1);
+    }
+
+    bool empty() const { return k_ == 0 || !live_[tree_[0]]; }
+    int64_t top() const { return key_[tree_[0]]; }
+
+    void pop() {
+        size_t w = tree_[0];
+        live_[w] = src_[w]->next(key_[w]);
+        for (size_t node = (w + k_) / 2; node > 0; node /= 2) {
+            if (beats(tree_[node], w)) std::swap(tree_[node], w);
+        }
+        tree_[0] = w;
+    }
+
+private:
+    bool beats(size_t a, size_t b) const {
+        if (!live_[a]) return false;
+        if (!live_[b]) return true;
+        return key_[a] < key_[b] || (key_[a] == key_[b] && a < b);
+    }
+
+    size_t build(size_t node) {
+        if (node >= k_) return node - k_;
+        size_t a = build(2 * node);
+        size_t b = build(2 * node + 1);
+        if (beats(a, b)) std::swap(a, b);
+        tree_[node] = a;
+        return b;
+    }
+
+    std::vector<BlockReader*> src_;
+    size_t k_;
+    std::vector<int64_t> key_;
+    std::vector<char> live_;
+    std::vector<size_t> tree_;
+};
+
+bool merge_runs(const std::vector<std::string>& runs, const std::string& output, size_t blockKeys,
+                IoThread& io, std::string& error) {
+    std::vector<std::unique_ptr<BlockReader>> readers;
+    std::vector<BlockReader*> sources;
+    for (const std::string& r : runs) {
+        FilePtr f = open_file(r, "rb", error);
+        if (!f) return false;
+        readers.push_back(std::make_unique<BlockReader>(std::move(f), blockKeys, io));
+        sources.push_back(readers.back().get());
+    }
+    FilePtr out = open_file(output, "wb", error);
+    if (!out) return false;
+
+    BlockWriter writer(std::move(out), blockKeys, io);
+    for (LoserTree tree(sources); !tree.empty(); tree.pop()) writer.push(tree.top());
+
+    for (const auto& r : readers) {
+        if (r->failed()) {
+            error = "read error while merging runs";
+            return false;
+        }
+    }
+    if (!writer.finish()) {
+        error = "write error on " + output;
+        return false;
+    }
+    return true;
+}
+
+std::string run_path(const std::string& output, const std::string& tempDir, int pass, size_t index) {
+    namespace fs = std::filesystem;
+    fs::path out(output);
+    fs::path dir = tempDir.empty() ? out.parent_path() : fs::path(tempDir);
+    std::string name = out.filename().string() + ".run" + std::to_string(pass) + "." + std::to_string(index);
+    return (dir / name).string();
+}
+
+void remove_files(const std::vector<std::string>& paths) {
+    for (const std::string& p : paths) std::remove(p.c_str());
+}
+
+}
+
+bool external_sort(const std::string& input, const std::string& output, ISorterT<int64_t>& runSorter,
+                   const ExternalSortConfig& cfg, ExternalSortStats& stats, std::string& error) {
+    stats = ExternalSortStats();
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(input, ec);
+    if (ec) {
+        error = "cannot stat " + input + ": " + ec.message();
+        return false;
+    }
+    if (bytes % kKey != 0) {
+        error = input + " is not a whole number of int64 keys";
+        return false;
+    }
+    stats.bytes = bytes;
+    const uint64_t total = bytes / kKey;
+
+    // Run generation keeps two run buffers (one being sorted, one being
+    // read or written) and leaves a third of the budget for the sorter's
+    // own scratch; merging holds two blocks per input and two for output.
+    const size_t runKeys = std::max<size_t>(1, cfg.memoryBytes / 3 / kKey);
+    const size_t blockKeys = std::max<size_t>(1, std::min(cfg.blockBytes, cfg.memoryBytes / 6) / kKey);
+    stats.fanIn = std::max<size_t>(2, cfg.memoryBytes / (2 * blockKeys * kKey) - 1);
+
+    FilePtr in = open_file(input, "rb", error);
+    if (!in) return false;
+
+    // A single run goes straight to the output.
+    const bool oneRun = total <= runKeys;
+    std::vector<std::string> runs;
+    std::vector<FilePtr> runFiles;
+    std::vector<std::future<size_t>> writes;
+    std::vector<size_t> expected;
+    const size_t firstKeys = static_cast<size_t>(std::min<uint64_t>(total, runKeys));
+    std::vector<int64_t> cur(firstKeys), next(oneRun ? 0 : runKeys);
+    // Declared after every buffer and file it touches: on an early return
+    // it is destroyed first, and its destructor drains the queued I/O.
+    IoThread io;
+
+    auto t0 = Clock::now();
+    size_t len = io.read(in.get(), cur.data(), cur.size()).get();
+    if (len != cur.size()) {
+        error = "short read on " + input;
+        return false;
+    }
+    uint64_t done = 0;
+    while (len > 0) {
+        cur.resize(len);
+        done += len;
+        std::future<size_t> nextRead;
+        if (done < total) nextRead = io.read(in.get(), next.data(), next.size());
+
+        runSorter.sort(cur);
+
+        std::string path = oneRun ? output : run_path(output, cfg.tempDir, 0, runs.size());
+        FilePtr f = open_file(path, "wb", error);
+        if (!f) {
+            remove_files(runs);
+            return false;
+        }
+        writes.push_back(io.write(f.get(), cur.data(), cur.size()));
+        expected.push_back(cur.size());
+        runFiles.push_back(std::move(f));
+        runs.push_back(path);
+
+        len = nextRead.valid() ? nextRead.get() : 0;
+        // The next read into this run's buffer is queued behind its write.
+        std::swap(cur, next);
+    }
+    bool ok = done == total;
+    for (size_t i = 0; i < writes.size(); ++i) ok = writes[i].get() == expected[i] && ok;
+    for (FilePtr& f : runFiles) ok = std::fflush(f.get()) == 0 && ok;
+    runFiles.clear();
+    in.reset();
+    stats.runSeconds = seconds_since(t0);
+    stats.runs = runs.size();
+    if (!ok) {
+        error = "I/O error while writing runs";
+        if (!oneRun) remove_files(runs);
+        return false;
+    }
+
+    t0 = Clock::now();
+    if (runs.empty()) {
+        // Empty input: still produce an (empty) output file.
+        if (!open_file(output, "wb", error)) return false;
+    }
+    for (int pass = 1; runs.size() > 1; ++pass) {
+        const bool last = runs.size() <= stats.fanIn;
+        std::vector<std::string> merged;
+        for (size_t g = 0; g < runs.size(); g += stats.fanIn) {
+            std::vector<std::string> group(runs.begin() + g, runs.begin() + std::min(runs.size(), g + stats.fanIn));
+            if (group.size() == 1) {
+                merged.push_back(group[0]);
+                continue;
+            }
+            std::string dest = last ? output : run_path(output, cfg.tempDir, pass, merged.size());
+            if (!merge_runs(group, dest, blockKeys, io, error)) {
+                remove_files(runs);
+                remove_files(merged);
+                return false;
+            }
+            remove_files(group);
+            merged.push_back(dest);
+        }
+        runs.swap(merged);
+        stats.mergePasses = pass;
+    }
+    stats.mergeSeconds = seconds_since(t0);
+    return true;
+}
+
+bool scan_key_file(const std::string& path, uint64_t& count, uint64_t& digest, bool& sorted,
+                   std::string& error) {
+    FilePtr f = open_file(path, "rb", error);
+    if (!f) return false;
+
+    count = 0;
+    digest = 0;
+    sorted = true;
+    std::vector<int64_t> buf(size_t(1) << 20);
+    bool first = true;
+    int64_t prev = 0;
+    for (;;) {
+        buf.resize(buf.capacity());
+        size_t got = std::fread(buf.data(), kKey, buf.size(), f.get());
+        if (got == 0) break;
+        buf.resize(got);
+        if (!first && buf.front() < prev) sorted = false;
+        if (sorted && !std::is_sorted(buf.begin(), buf.end())) sorted = false;
+        digest += multiset_digest(buf);
+        count += got;
+        prev = buf.back();
+        first = false;
+    }
+    if (std::ferror(f.get())) {
+        error = "read error on " + path;
+        return false;
+    }
+    return true;
+}
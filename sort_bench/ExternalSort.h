@@ -0,0 +1,37 @@
+#pragma once
+#include "Sorter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ExternalSortConfig {
+    size_t memoryBytes{size_t(256) << 20};  // run buffers during run generation, I/O blocks during merging
+    size_t blockBytes{size_t(4) << 20};     // unit of every merge read and write
+    std::string tempDir;                    // run files; empty = next to the output
+};
+
+struct ExternalSortStats {
+    uint64_t bytes{0};
+    size_t runs{0};         // initial sorted runs
+    size_t fanIn{0};        // runs merged at once
+    int mergePasses{0};
+    double runSeconds{0};   // reading, sorting and writing the initial runs
+    double mergeSeconds{0};
+
+    double seconds() const { return runSeconds + mergeSeconds; }
+    double mbPerSec() const { return seconds() > 0 ? static_cast<double>(bytes) / 1e6 / seconds() : 0.0; }
+};
+
+// Sorts a file of native-endian int64 keys into `output` using about
+// cfg.memoryBytes of buffers. Input is read in large sequential chunks,
+// each chunk is sorted by runSorter and written as a run while the next
+// one is read; the runs are then combined by loser-tree k-way merges with
+// every input and the output double-buffered on a background I/O thread.
+// Returns false and sets `error` on I/O failure.
+bool external_sort(const std::string& input, const std::string& output, ISorterT<int64_t>& runSorter,
+                   const ExternalSortConfig& cfg, ExternalSortStats& stats, std::string& error);
+
+// Streams a key file: element count, multiset_digest of the keys and
+// whether they are in ascending order.
+bool scan_key_file(const std::string& path, uint64_t& count, uint64_t& digest, bool& sorted,
+                   std::string& error);
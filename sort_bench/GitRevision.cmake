@@ -0,0 +1,14 @@
+# Writes OUTPUT from GitRevision.h.in with the `git describe` of SOURCE_DIR.
+# Run by the sort_bench_git_rev target: cmake -DGIT_EXECUTABLE=...
+# -DSOURCE_DIR=... -DOUTPUT=... -P GitRevision.cmake
+set(SORT_BENCH_GIT_REV unknown)
+if(GIT_EXECUTABLE)
+    execute_process(COMMAND ${GIT_EXECUTABLE} describe --always --dirty --abbrev=12
+                    WORKING_DIRECTORY ${SOURCE_DIR}
+                    OUTPUT_VARIABLE git_rev OUTPUT_STRIP_TRAILING_WHITESPACE
+                    RESULT_VARIABLE git_result ERROR_QUIET)
+    if(git_result EQUAL 0 AND git_rev)
+        set(SORT_BENCH_GIT_REV ${git_rev})
+    endif()
+endif()
+configure_file(${CMAKE_CURRENT_LIST_DIR}/GitRevision.h.in ${OUTPUT} @ONLY)
@@ -0,0 +1,126 @@
+#pragma once
+#include "NaturalMergeSort.h"
+#include "PdqSort.h"
+#include "RadixSort.h"
+#include "SegmentedSort.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Keeping an array sorted under a stream of small updates, instead of
+// re-sorting all of it for each one. New keys are sorted on their own at
+// the end of the array and merged into the rest with NaturalMergeSort's
+// galloping merge: the base elements before the smallest new key and
+// after the largest are never touched, and between new keys the base is
+// skipped by exponential search and moved in blocks, so a delta of d keys
+// into n costs about d log(n / d) comparisons plus moving the part of the
+// base it lands in. Deletes come in sorted batches and compact the array
+// in one pass.
+namespace incremental {
+
+constexpr size_t kRadixMin = size_t(1) << 15;  // deltas from this size are radix sorted when the key allows
+
+// Sorts a delta of n keys with the routine that suits its size: the
+// segmented sort's networks and block merge up to segmented::kMergeMax,
+// radix sort from kRadixMin when its key order is Compare's, and pdqsort
+// otherwise.
+template <typename T, typename Compare, typename Counted>
+void sort_delta(T* a, size_t n, Counted& cmp, SortWorkspace* ws) {
+    if (n <= segmented::kMergeMax) {
+        Scratch<T> buf(ws, segmented::kMergeMax);
+        segmented::sort_segment(a, n, buf.data(), cmp);
+        return;
+    }
+    if constexpr (radix_compatible<T, Compare>::value) {
+        if (n >= kRadixMin) {
+            radix::sort(a, n, 1, ws);
+            return;
+        }
+    }
+    pdq::sort(a, a + n, cmp);
+}
+
+// Removes from the sorted a[0, n) one element equivalent to each of the
+// sorted keys[0, k), keys without a match being ignored, and returns the
+// new length. Elements between two removals move down in one block.
+template <typename T, typename Compare>
+size_t erase_sorted(T* a, size_t n, const T* keys, size_t k, Compare& cmp) {
+    size_t read = 0, write = 0;
+    for (size_t i = 0; i < k && read < n; ++i) {
+        const size_t p = read + natural::gallop<true>(keys[i], a + read, n - read, false, cmp);
+        if (p == n || cmp(keys[i], a[p])) continue;
+        if (write != read) {
+            std::move(a + read, a + p, a + write);
+            ops::moved(p - read, sizeof(T));
+        }
+        write += p - read;
+        read = p + 1;
+    }
+    if (write == read) return n;
+    std::move(a + read, a + n, a + write);
+    ops::moved(n - read, sizeof(T));
+    return write + (n - read);
+}
+
+// A sorted array that takes batches of inserts and deletes. maxBuffer
+// bounds the merge buffer: a larger delta is merged a piece of that many
+// keys at a time, each piece a pass over the base above where it lands.
+// 0 means one merge with a buffer of up to the delta's size. Scratch is
+// borrowed from a private workspace, so once warmed up an update does
+// not allocate unless the array itself grows.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class SortedArray {
+public:
+    explicit SortedArray(size_t maxBuffer = 0, Compare cmp = Compare()) : maxBuffer_(maxBuffer), cmp_(cmp) {}
+
+    // `sorted` must already be in Compare order.
+    void assign(std::vector<T> sorted) { a_ = std::move(sorted); }
+
+    // Room for n elements, so inserts up to that size do not reallocate.
+    void reserve(size_t n) { a_.reserve(n); }
+
+    void insert(const T* keys, size_t n) {
+        if (n == 0) return;
+        const size_t m = a_.size();
+        a_.insert(a_.end(), keys, keys + n);
+        ops::moved(n, sizeof(T));
+        T* a = a_.data();
+        sort_delta<T, Compare>(a + m, n, cmp_, &ws_);
+        if (m == 0) return;
+
+        const size_t piece = maxBuffer_ ? std::min(maxBuffer_, n) : n;
+        Scratch<T> tmp(&ws_, piece);
+        ops::scratch(piece * sizeof(T));
+        for (size_t done = 0; done < n; done += piece) {
+            natural::merge_runs(a, m + done, std::min(piece, n - done), tmp.data(), minGallop_, cmp_);
+        }
+    }
+
+    void insert(const std::vector<T>& keys) { insert(keys.data(), keys.size()); }
+
+    // Removes one element equivalent to each key present; returns how many.
+    size_t erase(const T* keys, size_t n) {
+        if (n == 0 || a_.empty()) return 0;
+        Scratch<T> sorted(&ws_, n);
+        std::copy(keys, keys + n, sorted.data());
+        ops::moved(n, sizeof(T));
+        sort_delta<T, Compare>(sorted.data(), n, cmp_, &ws_);
+        const size_t before = a_.size();
+        a_.resize(erase_sorted(a_.data(), before, sorted.data(), n, cmp_));
+        return before - a_.size();
+    }
+
+    size_t erase(const std::vector<T>& keys) { return erase(keys.data(), keys.size()); }
+
+    const std::vector<T>& data() const { return a_; }
+    size_t size() const { return a_.size(); }
+
+private:
+    size_t maxBuffer_;
+    ops::Counting<Compare> cmp_;
+    std::vector<T> a_;
+    SortWorkspace ws_;
+    size_t minGallop_{natural::kMinGallop};
+};
+
+}
@@ -0,0 +1,200 @@
+#include "Json.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace json {
+
+const Value* Value::find(const std::string& key) const {
+    if (type != Type::Object) return nullptr;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) return &items[i];
+    }
+    return nullptr;
+}
+
+double Value::num(const std::string& key, double fallback) const {
+    const Value* v = find(key);
+    return v && v->type == Type::Number ? v->number : fallback;
+}
+
+std::string Value::str(const std::string& key) const {
+    const Value* v = find(key);
+    return v && v->type == Type::String ? v->string : std::string();
+}
+
+bool Value::flag(const std::string& key) const {
+    const Value* v = find(key);
+    return v && v->type == Type::Bool && v->boolean;
+}
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : s_(text) {}
+
+    bool parseDocument(Value& out, std::string& error) {
+        if (!value(out, 0) || (skipSpace(), pos_ != s_.size())) {
+            error = "JSON parse error at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    void skipSpace() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r')) ++pos_;
+    }
+
+    bool literal(const char* word) {
+        size_t len = std::char_traits<char>::length(word);
+        if (s_.compare(pos_, len, word) != 0) return false;
+        pos_ += len;
+        return true;
+    }
+
+    bool value(Value& v, int depth) {
+        skipSpace();
+        if (pos_ >= s_.size() || depth > kMaxDepth) return false;
+        char c = s_[pos_];
+        if (c == '{') return object(v, depth);
+        if (c == '[') return array(v, depth);
+        if (c == '"') {
+            v.type = Value::Type::String;
+            return string(v.string);
+        }
+        if (literal("true")) {
+            v.type = Value::Type::Bool;
+            v.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            v.type = Value::Type::Bool;
+            return true;
+        }
+        if (literal("null")) return true;
+        return number(v);
+    }
+
+    bool number(Value& v) {
+        const char* begin = s_.c_str() + pos_;
+        char* end = nullptr;
+        v.number = std::strtod(begin, &end);
+        if (end == begin) return false;
+        v.type = Value::Type::Number;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    bool string(std::string& out) {
+        ++pos_;  // opening quote
+        while (pos_ < s_.size()) {
+            char c = s_[pos_++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= s_.size()) return false;
+            char e = s_[pos_++];
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    // Report only escapes control characters, so code points
+                    // above 0x7F are kept as '?' rather than re-encoded.
+                    if (pos_ + 4 > s_.size()) return false;
+                    unsigned cp = static_cast<unsigned>(std::strtoul(s_.substr(pos_, 4).c_str(), nullptr, 16));
+                    out += cp < 0x80 ? static_cast<char>(cp) : '?';
+                    pos_ += 4;
+                    break;
+                }
+                default: out += e; break;
+            }
+        }
+        return false;
+    }
+
+    bool array(Value& v, int depth) {
+        v.type = Value::Type::Array;
+        ++pos_;
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == ']') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            v.items.emplace_back();
+            if (!value(v.items.back(), depth + 1)) return false;
+            skipSpace();
+            if (pos_ >= s_.size()) return false;
+            char c = s_[pos_++];
+            if (c == ']') return true;
+            if (c != ',') return false;
+        }
+    }
+
+    bool object(Value& v, int depth) {
+        v.type = Value::Type::Object;
+        ++pos_;
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == '}') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (pos_ >= s_.size() || s_[pos_] != '"') return false;
+            v.keys.emplace_back();
+            if (!string(v.keys.back())) return false;
+            skipSpace();
+            if (pos_ >= s_.size() || s_[pos_++] != ':') return false;
+            v.items.emplace_back();
+            if (!value(v.items.back(), depth + 1)) return false;
+            skipSpace();
+            if (pos_ >= s_.size()) return false;
+            char c = s_[pos_++];
+            if (c == '}') return true;
+            if (c != ',') return false;
+        }
+    }
+
+    const std::string& s_;
+    size_t pos_{0};
+};
+
+}
+
+bool parse(const std::string& text, Value& out, std::string& error) {
+    out = Value();
+    return Parser(text).parseDocument(out, error);
+}
+
+std::string quote(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+}
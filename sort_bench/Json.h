@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Just enough JSON to read back the files Report writes.
+namespace json {
+
+struct Value {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type{Type::Null};
+    bool boolean{false};
+    double number{0};
+    std::string string;
+    std::vector<Value> items;       // array elements, or object values
+    std::vector<std::string> keys;  // object keys, parallel to items
+
+    const Value* find(const std::string& key) const;
+    double num(const std::string& key, double fallback = 0) const;
+    std::string str(const std::string& key) const;
+    bool flag(const std::string& key) const;
+};
+
+bool parse(const std::string& text, Value& out, std::string& error);
+
+// `s` as a quoted JSON string.
+std::string quote(const std::string& s);
+
+}
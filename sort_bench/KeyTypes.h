@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// (key, payload) record, ordered by key only.
+struct Record {
+    uint64_t key;
+    uint64_t payload;
+};
+
+struct RecordByKey {
+    bool operator()(const Record& a, const Record& b) const { return a.key < b.key; }
+};
+
+// Record widened to Bytes with more payload words, standing in for a row
+// with several columns.
+template <size_t Bytes>
+struct WideRecord {
+    static_assert(Bytes >= 16 && Bytes % 8 == 0, "WideRecord is a key plus whole payload words");
+    uint64_t key;
+    uint64_t payload[Bytes / 8 - 1];
+};
+
+// The narrowest row is the key alone.
+template <>
+struct WideRecord<8> {
+    uint64_t key;
+};
+
+struct WideRecordByKey {
+    template <size_t Bytes>
+    bool operator()(const WideRecord<Bytes>& a, const WideRecord<Bytes>& b) const { return a.key < b.key; }
+};
+
+// Per-key-type defaults: the comparator sorters use when none is given, and
+// how DataGenerator turns a generated integer value into a key.
+template <typename T>
+struct KeyTraits {
+    using Compare = std::less<T>;
+    static T make(int64_t value, uint64_t index) {
+        (void) index;
+        return static_cast<T>(value);
+    }
+};
+
+template <>
+struct KeyTraits<Record> {
+    using Compare = RecordByKey;
+    static Record make(int64_t value, uint64_t index) {
+        return Record{static_cast<uint64_t>(value), index};
+    }
+};
+
+// Every payload word holds the generated index.
+template <size_t Bytes>
+struct KeyTraits<WideRecord<Bytes>> {
+    using Compare = WideRecordByKey;
+    static WideRecord<Bytes> make(int64_t value, uint64_t index) {
+        WideRecord<Bytes> r;
+        r.key = static_cast<uint64_t>(value);
+        if constexpr (Bytes > 8) {
+            for (uint64_t& w : r.payload) w = index;
+        } else {
+            (void) index;
+        }
+        return r;
+    }
+};
+
+template <typename T> const char* key_name();
+template <> inline const char* key_name<int32_t>() { return "int32"; }
+template <> inline const char* key_name<int64_t>() { return "int64"; }
+template <> inline const char* key_name<uint64_t>() { return "uint64"; }
+template <> inline const char* key_name<float>() { return "float"; }
+template <> inline const char* key_name<double>() { return "double"; }
+template <> inline const char* key_name<Record>() { return "record16"; }
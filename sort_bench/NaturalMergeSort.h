@@ -0,0 +1,275 @@
+#pragma once
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace natural {
+
+constexpr size_t kMinGallop = 7;  // initial run of wins that switches a merge to galloping
+
+// Length of the monotone run starting at a[0]: non-descending, or
+// strictly descending (strictness keeps reversal stable).
+template <typename T, typename Compare>
+size_t run_length(const T* a, size_t n, Compare& cmp) {
+    if (n < 2) return n;
+    size_t len = 2;
+    if (cmp(a[1], a[0])) {
+        while (len < n && cmp(a[len], a[len - 1])) ++len;
+    } else {
+        while (len < n && !cmp(a[len], a[len - 1])) ++len;
+    }
+    return len;
+}
+
+// Like run_length, but reverses a descending run in place.
+template <typename T, typename Compare>
+size_t find_run(T* a, size_t n, Compare& cmp) {
+    size_t len = run_length(a, n, cmp);
+    if (len > 1 && cmp(a[1], a[0])) {
+        std::reverse(a, a + len);
+        ops::swapped(len / 2, sizeof(T));
+    }
+    return len;
+}
+
+// TimSort's minimum run length for n: between 32 and 64, chosen so that
+// n / minrun is a power of two or just below one.
+inline size_t min_run(size_t n) {
+    size_t r = 0;
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// Extends the sorted prefix a[0, sorted) to all of a[0, n) by binary
+// insertion: O(n log n) comparisons, and equal elements stay in order.
+template <typename T, typename Compare>
+void binary_insertion_sort(T* a, size_t n, size_t sorted, Compare& cmp) {
+    for (size_t i = std::max<size_t>(sorted, 1); i < n; ++i) {
+        T x = ops::move(a[i]);
+        T* pos = std::upper_bound(a, a + i, x, cmp);
+        std::move_backward(pos, a + i, a + i + 1);
+        ops::moved(static_cast<size_t>(a + i - pos), sizeof(T));
+        *pos = ops::move(x);
+    }
+}
+
+// Number of elements of the sorted a[0, n) that go before key: those
+// ordered before it when Left (a lower bound), those not ordered after
+// it otherwise (an upper bound). An exponential search from the front or
+// the back brackets the answer, so it costs O(log d) comparisons for an
+// answer d elements from that end, then a binary search finishes.
+template <bool Left, typename T, typename Compare>
+size_t gallop(const T& key, const T* a, size_t n, bool fromBack, Compare& cmp) {
+    auto before = [&](const T& x) { return Left ? cmp(x, key) : !cmp(key, x); };
+    size_t lo = 0, hi = n, step = 1;
+    if (!fromBack) {
+        while (lo + step <= n && before(a[lo + step - 1])) {
+            lo += step;
+            step *= 2;
+        }
+        hi = std::min(n, lo + step - 1);
+    } else {
+        while (step <= hi && !before(a[hi - step])) {
+            hi -= step;
+            step *= 2;
+        }
+        lo = hi >= step ? hi - step + 1 : 0;
+    }
+    return static_cast<size_t>(std::partition_point(a + lo, a + hi, before) - a);
+}
+
+// Merges a[0, len1) and a[len1, len1 + len2) with the first run copied to
+// tmp, front to back. Elements are taken one at a time until one side
+// wins minGallop times in a row; then both sides are galloped in bulk,
+// until neither gallop moves kMinGallop elements. minGallop adapts: it
+// drops while galloping pays and grows when it stops paying.
+template <typename T, typename Compare>
+void merge_lo(T* a, size_t len1, size_t len2, T* tmp, size_t& minGallop, Compare& cmp) {
+    std::move(a, a + len1, tmp);
+    ops::moved(len1, sizeof(T));
+    T* p1 = tmp;
+    T* const e1 = tmp + len1;
+    T* p2 = a + len1;
+    T* const e2 = a + len1 + len2;
+    T* out = a;
+    while (p1 != e1 && p2 != e2) {
+        // Branch-free selection; `streak` counts consecutive wins by one side.
+        size_t streak = 0;
+        bool last = false;
+        while (p1 != e1 && p2 != e2 && streak < minGallop) {
+            const bool second = cmp(*p2, *p1);
+            *out++ = ops::move(second ? *p2 : *p1);
+            p2 += second;
+            p1 += !second;
+            streak = second == last ? streak + 1 : 1;
+            last = second;
+        }
+        while (p1 != e1 && p2 != e2) {
+            const size_t k1 = gallop<false>(*p2, p1, static_cast<size_t>(e1 - p1), false, cmp);
+            out = std::move(p1, p1 + k1, out);
+            p1 += k1;
+            if (p1 == e1) break;
+            const size_t k2 = gallop<true>(*p1, p2, static_cast<size_t>(e2 - p2), false, cmp);
+            out = std::move(p2, p2 + k2, out);
+            p2 += k2;
+            ops::moved(k1 + k2, sizeof(T));
+            if (k1 < kMinGallop && k2 < kMinGallop) {
+                ++minGallop;
+                break;
+            }
+            if (minGallop > 1) --minGallop;
+        }
+    }
+    // What is left of the second run is already in place.
+    std::move(p1, e1, out);
+    ops::moved(static_cast<size_t>(e1 - p1), sizeof(T));
+}
+
+// Mirror of merge_lo for a shorter second run: it is copied to tmp and
+// the merge runs back to front.
+template <typename T, typename Compare>
+void merge_hi(T* a, size_t len1, size_t len2, T* tmp, size_t& minGallop, Compare& cmp) {
+    std::move(a + len1, a + len1 + len2, tmp);
+    ops::moved(len2, sizeof(T));
+    T* const b1 = a;
+    T* p1 = a + len1;
+    T* const b2 = tmp;
+    T* p2 = tmp + len2;
+    T* out = a + len1 + len2;
+    while (p1 != b1 && p2 != b2) {
+        size_t streak = 0;
+        bool last = false;
+        while (p1 != b1 && p2 != b2 && streak < minGallop) {
+            const bool first = cmp(p2[-1], p1[-1]);
+            *--out = ops::move(first ? p1[-1] : p2[-1]);
+            p1 -= first;
+            p2 -= !first;
+            streak = first == last ? streak + 1 : 1;
+            last = first;
+        }
+        while (p1 != b1 && p2 != b2) {
+            const size_t n1 = static_cast<size_t>(p1 - b1);
+            const size_t k1 = n1 - gallop<false>(p2[-1], b1, n1, true, cmp);
+            out = std::move_backward(p1 - k1, p1, out);
+            p1 -= k1;
+            if (p1 == b1) break;
+            const size_t n2 = static_cast<size_t>(p2 - b2);
+            const size_t k2 = n2 - gallop<true>(p1[-1], b2, n2, true, cmp);
+            out = std::move_backward(p2 - k2, p2, out);
+            p2 -= k2;
+            ops::moved(k1 + k2, sizeof(T));
+            if (k1 < kMinGallop && k2 < kMinGallop) {
+                ++minGallop;
+                break;
+            }
+            if (minGallop > 1) --minGallop;
+        }
+    }
+    // What is left of the first run is already in place.
+    std::move_backward(b2, p2, out);
+    ops::moved(static_cast<size_t>(p2 - b2), sizeof(T));
+}
+
+// Merges the adjacent sorted runs a[0, len1) and a[len1, len1 + len2).
+// Elements of the first run not after the second's first, and of the
+// second not before the first's last, are already in place and are cut
+// off by galloping before the shorter remaining side goes to tmp.
+template <typename T, typename Compare>
+void merge_runs(T* a, size_t len1, size_t len2, T* tmp, size_t& minGallop, Compare& cmp) {
+    const size_t skip = gallop<false>(a[len1], a, len1, false, cmp);
+    a += skip;
+    len1 -= skip;
+    if (len1 == 0) return;
+    len2 = gallop<true>(a[len1 - 1], a + len1, len2, true, cmp);
+    if (len2 == 0) return;
+    if (len1 <= len2) merge_lo(a, len1, len2, tmp, minGallop, cmp);
+    else merge_hi(a, len1, len2, tmp, minGallop, cmp);
+}
+
+// Powersort's merge priority for the boundary between the adjacent runs
+// [s1, s1 + n1) and [s1 + n1, s1 + n1 + n2) of an array of n: the depth
+// at which a perfectly balanced merge tree over [0, n) would split
+// between the runs' midpoints.
+inline unsigned node_power(size_t s1, size_t n1, size_t n2, size_t n) {
+    size_t a = 2 * s1 + n1;
+    size_t b = a + n1 + n2;
+    unsigned power = 0;
+    for (;;) {
+        ++power;
+        if (a >= n) {
+            a -= n;
+            b -= n;
+        } else if (b >= n) {
+            break;
+        }
+        a <<= 1;
+        b <<= 1;
+    }
+    return power;
+}
+
+// Stable TimSort-style natural merge sort. Ascending and strictly
+// descending runs are found as they are (descending ones reversed), runs
+// shorter than min_run(n) are extended by binary insertion, and runs
+// are merged in powersort order: a run boundary is merged once a later
+// boundary has lower power, which keeps the merge tree within a constant
+// of optimal for the run lengths. Merges gallop through stretches where
+// one run wins repeatedly. Linear on sorted or reversed input and
+// O(n log r) for r runs; scratch is at most n / 2 elements, and none
+// when the input is a single run.
+template <typename T, typename Compare>
+void sort(T* a, size_t n, Compare& cmp, SortWorkspace* ws = nullptr) {
+    struct Run {
+        size_t start;
+        size_t len;
+        unsigned power;
+    };
+    const size_t minRun = min_run(n);
+    auto next_run = [&](size_t start) {
+        const size_t len = find_run(a + start, n - start, cmp);
+        const size_t want = std::min(minRun, n - start);
+        if (len >= want) return len;
+        binary_insertion_sort(a + start, want, len, cmp);
+        return want;
+    };
+
+    Run prev{0, next_run(0), 0};
+    if (prev.len == n) return;
+
+    Scratch<T> tmp(ws, n / 2);
+    ops::scratch(n / 2 * sizeof(T));
+    size_t minGallop = kMinGallop;
+    auto merge_top = [&](const Run& left) {
+        merge_runs(a + left.start, left.len, prev.len, tmp.data(), minGallop, cmp);
+        prev.start = left.start;
+        prev.len += left.len;
+    };
+
+    // Powers on the stack strictly increase, so it holds at most one run
+    // per bit of n.
+    Run stack[sizeof(size_t) * 8 + 2];
+    size_t depth = 0;
+    for (size_t i = prev.len; i < n;) {
+        const size_t len = next_run(i);
+        const unsigned power = node_power(prev.start, prev.len, len, n);
+        while (depth > 0 && stack[depth - 1].power > power) merge_top(stack[--depth]);
+        stack[depth++] = {prev.start, prev.len, power};
+        prev = {i, len, 0};
+        i += len;
+    }
+    while (depth > 0) merge_top(stack[--depth]);
+}
+
+}
+
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class NaturalMergeSorter final : public Sorter<T, Compare> {
+public:
+    using Sorter<T, Compare>::Sorter;
+    std::string name() const override { return "NaturalMerge"; }
+    void sort(std::vector<T>& a) override { natural::sort(a.data(), a.size(), this->cmp_, this->workspace_); }
+};
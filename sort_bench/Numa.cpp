@@ -0,0 +1,129 @@
+#include "Numa.h"
+#include "Parallel.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace numa {
+
+// Parses the kernel's list format, e.g. "0-3,8-11".
+static std::vector<int> parse_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty() || item == "\n") continue;
+        const size_t dash = item.find('-');
+        try {
+            const int lo = std::stoi(item.substr(0, dash));
+            const int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+            for (int i = lo; i <= hi; ++i) out.push_back(i);
+        } catch (...) {
+            return {};
+        }
+    }
+    return out;
+}
+
+static bool read_list(const std::string& path, std::vector<int>& out) {
+    std::ifstream f(path);
+    std::string line;
+    if (!f || !std::getline(f, line)) return false;
+    out = parse_list(line);
+    return true;
+}
+
+static std::vector<Node> detect() {
+    std::vector<Node> found;
+#if defined(__linux__)
+    const std::string root = "/sys/devices/system/node/";
+    std::vector<int> ids;
+    if (read_list(root + "online", ids)) {
+        for (int id : ids) {
+            Node node;
+            node.id = id;
+            if (read_list(root + "node" + std::to_string(id) + "/cpulist", node.cpus) && !node.cpus.empty()) {
+                found.push_back(std::move(node));
+            }
+        }
+    }
+#endif
+    if (found.empty()) {
+        Node all;
+        for (unsigned c = 0; c < resolve_threads(0); ++c) all.cpus.push_back(static_cast<int>(c));
+        found.push_back(std::move(all));
+    }
+    return found;
+}
+
+const std::vector<Node>& nodes() {
+    static const std::vector<Node> cached = detect();
+    return cached;
+}
+
+std::vector<int> current_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+#endif
+    return cpus;
+}
+
+bool pin_to_cpus(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+std::vector<size_t> place_threads(unsigned threads, int node) {
+    const std::vector<Node>& all = nodes();
+    std::vector<size_t> place;
+    if (node >= 0) {
+        const size_t k = static_cast<size_t>(node) % all.size();
+        place.assign(threads ? threads : all[k].cpus.size(), k);
+        return place;
+    }
+    size_t cpus = 0;
+    for (const Node& n : all) cpus += n.cpus.size();
+    place.resize(threads ? threads : cpus);
+    for (size_t t = 0; t < place.size(); ++t) place[t] = t % all.size();
+    return place;
+}
+
+NodeArenas::NodeArenas() {
+    for (size_t k = 0; k < nodes().size(); ++k) arenas_.push_back(std::make_unique<SortWorkspace>());
+}
+
+void NodeArenas::reserve(size_t node, size_t bytes) {
+    SortWorkspace& ws = *arenas_[node];
+    if (ws.capacity() >= bytes) return;
+    if (nodes().size() == 1) {
+        ws.reserve(bytes);
+        return;
+    }
+    std::thread toucher([&] {
+        pin_to_cpus(nodes()[node].cpus);
+        ws.reserve(bytes);
+    });
+    toucher.join();
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "SortWorkspace.h"
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// NUMA nodes and the logical CPUs on each, read from /sys/devices/system/
+// node on Linux without libnuma. Memory placement relies on the kernel's
+// default first-touch policy: a page lives on the node of the thread that
+// first writes it, so a buffer filled by threads pinned to one node stays
+// local to them. Elsewhere, or when the kernel lists no nodes, the whole
+// machine is one node and nothing is pinned.
+namespace numa {
+
+struct Node {
+    int id{0};
+    std::vector<int> cpus;
+};
+
+// Nodes that have CPUs, detected once; never empty.
+const std::vector<Node>& nodes();
+
+// Affinity of the calling thread as CPU numbers; empty where unsupported.
+std::vector<int> current_cpus();
+
+// Restricts the calling thread to `cpus`; false if that is not possible.
+bool pin_to_cpus(const std::vector<int>& cpus);
+
+// Node index (into nodes()) for each of `threads` threads: round-robin
+// over all nodes when node < 0, so two threads land on two sockets, or
+// all on nodes()[node]. threads == 0 means one per CPU of those nodes.
+std::vector<size_t> place_threads(unsigned threads, int node = -1);
+
+// Runs fn(t) for every thread t of a placement, the caller being thread
+// 0. With `pin` each thread is first restricted to its node's CPUs; the
+// caller's own affinity is put back afterwards.
+template <typename Fn>
+void run_placed(const std::vector<size_t>& place, bool pin, Fn&& fn) {
+    if (place.size() <= 1 && !pin) {
+        fn(size_t{0});
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(place.size() - 1);
+    for (size_t t = 1; t < place.size(); ++t) {
+        pool.emplace_back([&, t] {
+            if (pin) pin_to_cpus(nodes()[place[t]].cpus);
+            fn(t);
+        });
+    }
+    std::vector<int> saved;
+    if (pin) {
+        saved = current_cpus();
+        pin_to_cpus(nodes()[place[0]].cpus);
+    }
+    fn(size_t{0});
+    if (!saved.empty()) pin_to_cpus(saved);
+    for (auto& t : pool) t.join();
+}
+
+// One workspace per node. reserve() grows a node's workspace from a
+// thread pinned to that node, so its pages are faulted in there and stay
+// there while the workspace is reused.
+class NodeArenas {
+public:
+    NodeArenas();
+    SortWorkspace& operator[](size_t node) { return *arenas_[node]; }
+    void reserve(size_t node, size_t bytes);
+
+private:
+    std::vector<std::unique_ptr<SortWorkspace>> arenas_;
+};
+
+}
@@ -0,0 +1,65 @@
+#include "OpCounts.h"
+
+#if SORT_BENCH_COUNT_OPS
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ops::detail::ThreadCounts*> live;
+    uint64_t exited[ops::kCounters] = {};
+};
+
+// Leaked so threads exiting during static destruction can still fold in.
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+}
+
+namespace ops {
+namespace detail {
+
+ThreadCounts::ThreadCounts() {
+    for (auto& x : c) x.store(0, std::memory_order_relaxed);
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(this);
+}
+
+ThreadCounts::~ThreadCounts() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (int i = 0; i < kCounters; ++i) r.exited[i] += c[i].load(std::memory_order_relaxed);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+}
+
+}
+
+Counts snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    uint64_t sum[kCounters];
+    std::copy(r.exited, r.exited + kCounters, sum);
+    for (const detail::ThreadCounts* t : r.live) {
+        for (int i = 0; i < kCounters; ++i) sum[i] += t->c[i].load(std::memory_order_relaxed);
+    }
+    return {sum[kComparisons], sum[kSwaps], sum[kMoves], sum[kScratchBytes], sum[kMovedBytes]};
+}
+
+}
+
+#else
+
+namespace ops {
+
+Counts snapshot() { return {}; }
+
+}
+
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Build with -DSORT_BENCH_COUNT_OPS=1 to count the work sorters do. The
+// sorters are written against the helpers below; with counting off every
+// helper is the plain operation and Counting<Compare> is Compare itself,
+// so the generated code is that of an uninstrumented build.
+#ifndef SORT_BENCH_COUNT_OPS
+#define SORT_BENCH_COUNT_OPS 0
+#endif
+
+#if SORT_BENCH_COUNT_OPS
+#include <atomic>
+#endif
+
+namespace ops {
+
+constexpr bool kEnabled = SORT_BENCH_COUNT_OPS != 0;
+
+// Comparator calls, element swaps, element moves and copies (including
+// into and out of scratch), the bytes those swaps and moves write, and
+// bytes of scratch memory allocated.
+// Library algorithms (std::sort, std::stable_sort, the heap functions)
+// only show up through their comparator calls.
+struct Counts {
+    uint64_t comparisons{0};
+    uint64_t swaps{0};
+    uint64_t moves{0};
+    uint64_t scratchBytes{0};
+    uint64_t movedBytes{0};  // written by swaps (both elements) and moves
+};
+
+inline Counts operator-(const Counts& a, const Counts& b) {
+    return {a.comparisons - b.comparisons, a.swaps - b.swaps, a.moves - b.moves, a.scratchBytes - b.scratchBytes,
+            a.movedBytes - b.movedBytes};
+}
+
+// Totals over every thread so far; all zero when counting is compiled out.
+Counts snapshot();
+
+enum Counter { kComparisons, kSwaps, kMoves, kScratchBytes, kMovedBytes, kCounters };
+
+#if SORT_BENCH_COUNT_OPS
+namespace detail {
+
+// Registered on first use so snapshot() can sum live threads, and folded
+// into a running total when the thread exits. Each has one writer, so a
+// relaxed load and store is enough and no read-modify-write is needed.
+struct ThreadCounts {
+    std::atomic<uint64_t> c[kCounters];
+    ThreadCounts();
+    ~ThreadCounts();
+};
+
+inline thread_local ThreadCounts tls;
+
+}
+#endif
+
+inline void add(Counter which, uint64_t k) {
+#if SORT_BENCH_COUNT_OPS
+    std::atomic<uint64_t>& c = detail::tls.c[which];
+    c.store(c.load(std::memory_order_relaxed) + k, std::memory_order_relaxed);
+#else
+    (void) which;
+    (void) k;
+#endif
+}
+
+// Bulk counts for work done outside the helpers (memcpy, vector compares).
+// moved() takes the size of the elements, so layouts that move the same
+// number of elements of different widths can be told apart.
+inline void compared(uint64_t k) { add(kComparisons, k); }
+inline void swapped(uint64_t k, size_t bytesEach) {
+    add(kSwaps, k);
+    add(kMovedBytes, 2 * k * bytesEach);
+}
+inline void moved(uint64_t k, size_t bytesEach) {
+    add(kMoves, k);
+    add(kMovedBytes, k * bytesEach);
+}
+inline void scratch(uint64_t bytes) { add(kScratchBytes, bytes); }
+
+template <typename T>
+inline void swap(T& a, T& b) {
+    swapped(1, sizeof(T));
+    std::swap(a, b);
+}
+
+template <typename T>
+inline void iter_swap(T* a, T* b) { swap(*a, *b); }
+
+// std::move that counts the move (or copy) the cast is used for.
+template <typename T>
+inline typename std::remove_reference<T>::type&& move(T&& x) {
+    moved(1, sizeof(typename std::remove_reference<T>::type));
+    return static_cast<typename std::remove_reference<T>::type&&>(x);
+}
+
+// a < b on keys compared outside a comparator (radix key bits).
+template <typename K>
+inline bool less(const K& a, const K& b) {
+    add(kComparisons, 1);
+    return a < b;
+}
+
+template <typename Compare>
+class CountedCompare {
+public:
+    explicit CountedCompare(Compare cmp = Compare()) : cmp_(cmp) {}
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        add(kComparisons, 1);
+        return cmp_(a, b);
+    }
+
+private:
+    Compare cmp_;
+};
+
+// The comparator sorters hold: Compare itself when counting is off.
+template <typename Compare>
+using Counting = typename std::conditional<kEnabled, CountedCompare<Compare>, Compare>::type;
+
+}
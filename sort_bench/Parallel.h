@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+inline unsigned resolve_threads(unsigned requested) {
+    if (requested > 0) return requested;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+// Number of chunks parallel_for will use for the same arguments, so callers
+// can size per-chunk state (histograms, offsets) up front.
+inline size_t parallel_chunks(size_t n, unsigned threads, size_t minChunk = 1 << 16) {
+    size_t maxChunks = std::max<size_t>(1, n / std::max<size_t>(1, minChunk));
+    return std::min<size_t>(resolve_threads(threads), maxChunks);
+}
+
+// Splits [0, n) into parallel_chunks() contiguous chunks and calls
+// fn(begin, end, chunkIndex) for each, one std::thread per chunk.
+// The split depends only on the arguments, so two calls with the same
+// arguments see the same chunk boundaries.
+template <typename Fn>
+void parallel_for(size_t n, unsigned threads, Fn&& fn, size_t minChunk = 1 << 16) {
+    size_t chunks = parallel_chunks(n, threads, minChunk);
+
+    if (chunks <= 1) {
+        fn(size_t{0}, n, size_t{0});
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(chunks - 1);
+    size_t step = (n + chunks - 1) / chunks;
+    for (size_t c = 1; c < chunks; ++c) {
+        size_t b = std::min(n, c * step);
+        size_t e = std::min(n, b + step);
+        pool.emplace_back([&fn, b, e, c] { fn(b, e, c); });
+    }
+    fn(size_t{0}, std::min(n, step), size_t{0});
+    for (auto& t : pool) t.join();
+}
+
+// Runs fn(i) for i in [0, count) on up to `threads` threads that pull
+// indices from a shared counter, for tasks of uneven size.
+template <typename Fn>
+void parallel_tasks(size_t count, unsigned threads, Fn&& fn) {
+    size_t workers = std::min<size_t>(resolve_threads(threads), count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) fn(i);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "SortAlgorithms.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pmerge {
+
+constexpr size_t kTaskCutoff = 1 << 13;    // below this, recursion stays on the current thread
+constexpr size_t kMergeCutoff = 1 << 15;   // below this, merges are sequential
+constexpr size_t kMergePiece = 1 << 14;    // output elements per parallel merge task
+
+// Number of elements taken from a when the first k outputs of the stable
+// merge of a and b are produced (Siebert & Traff co-rank).
+template <typename T, typename Compare>
+size_t co_rank(size_t k, const T* a, size_t na, const T* b, size_t nb, Compare& cmp) {
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = std::min(k, na);
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+        // a[i] must follow b[j - 1]; ties go to a, so a[i] <= b[j - 1] means take more from a.
+        if (j > 0 && !cmp(b[j - 1], a[i])) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+// Splits the output into pieces of about kMergePiece elements, finds each
+// piece's input boundaries with co_rank and merges the pieces as tasks.
+template <typename T, typename Compare>
+void merge(ThreadPool& pool, T* a, size_t na, T* b, size_t nb, T* out, Compare& cmp) {
+    const size_t n = na + nb;
+    if (n < kMergeCutoff || pool.threads() <= 1) {
+        detail::merge_into(a, na, b, nb, out, cmp);
+        return;
+    }
+
+    const size_t pieces = (n + kMergePiece - 1) / kMergePiece;
+    TaskGroup group(pool);
+    for (size_t p = 0; p < pieces; ++p) {
+        group.run([=, &cmp] {
+            size_t k0 = p * n / pieces;
+            size_t k1 = (p + 1) * n / pieces;
+            size_t i0 = co_rank(k0, a, na, b, nb, cmp);
+            size_t i1 = co_rank(k1, a, na, b, nb, cmp);
+            Compare local = cmp;
+            detail::merge_into(a + i0, i1 - i0, b + (k0 - i0), (k1 - i1) - (k0 - i0), out + k0, local);
+        });
+    }
+    group.wait();
+}
+
+// Same buffer alternation as detail::merge_sort_impl, with the two halves
+// forked as tasks and large merges split by co-rank.
+template <typename T, typename Compare>
+void sort(ThreadPool& pool, T* a, T* b, size_t n, bool intoB, Compare& cmp) {
+    if (n <= kTaskCutoff || pool.threads() <= 1) {
+        detail::merge_sort_impl(a, b, n, intoB, cmp);
+        return;
+    }
+    size_t m = n / 2;
+    {
+        TaskGroup group(pool);
+        group.run([=, &pool] {
+            Compare local = cmp;
+            sort(pool, a, b, m, !intoB, local);
+        });
+        sort(pool, a + m, b + m, n - m, !intoB, cmp);
+        group.wait();
+    }
+
+    if (intoB) merge(pool, a, m, a + m, n - m, b, cmp);
+    else merge(pool, b, m, b + m, n - m, a, cmp);
+}
+
+}
+
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class ParallelMergeSorter final : public Sorter<T, Compare> {
+public:
+    explicit ParallelMergeSorter(unsigned threads = 0, Compare cmp = Compare())
+        : Sorter<T, Compare>(cmp), pool_(std::make_unique<ThreadPool>(threads)) {}
+
+    std::string name() const override { return "ParallelMerge"; }
+    unsigned threads() const { return pool_->threads(); }
+    bool parallel() const override { return threads() > 1; }
+    bool keepsThreads() const override { return threads() > 1; }
+
+    void sort(std::vector<T>& a) override {
+        Scratch<T> tmp(this->workspace_, a.size());
+        ops::scratch(a.size() * sizeof(T));
+        pmerge::sort(*pool_, a.data(), tmp.data(), a.size(), false, this->cmp_);
+    }
+
+private:
+    std::unique_ptr<ThreadPool> pool_;
+};
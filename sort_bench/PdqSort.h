@@ -0,0 +1,390 @@
+#pragma once
+#include "Sorter.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Pattern-defeating quicksort (Orson Peters), over raw pointers.
+namespace pdq {
+
+constexpr ptrdiff_t kInsertionSortThreshold = 24;
+constexpr ptrdiff_t kNintherThreshold = 128;
+constexpr ptrdiff_t kPartialInsertionSortLimit = 8;
+constexpr ptrdiff_t kBlockSize = 64;
+constexpr size_t kCachelineSize = 64;
+
+// Block partitioning replaces the data-dependent branch of the partition
+// loop with an index store, which only pays off when the comparison
+// itself is a cheap, branch-free instruction.
+template <typename T, typename Compare>
+struct branchless_compare : std::false_type {};
+
+template <typename T>
+struct branchless_compare<T, std::less<T>> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct branchless_compare<T, std::greater<T>> : std::is_arithmetic<T> {};
+
+template <>
+struct branchless_compare<Record, RecordByKey> : std::true_type {};
+
+template <typename T, typename Compare>
+struct branchless_compare<T, ops::CountedCompare<Compare>> : branchless_compare<T, Compare> {};
+
+inline int log2(size_t n) {
+    int log = 0;
+    while (n >>= 1) ++log;
+    return log;
+}
+
+template <typename T, typename Compare>
+void insertion_sort(T* begin, T* end, Compare& comp) {
+    if (begin == end) return;
+    for (T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift1 = cur - 1;
+        if (comp(*sift, *sift1)) {
+            T tmp = ops::move(*sift);
+            do {
+                *sift-- = ops::move(*sift1);
+            } while (sift != begin && comp(tmp, *--sift1));
+            *sift = ops::move(tmp);
+        }
+    }
+}
+
+// Requires *(begin - 1) to be no greater than any element of [begin, end).
+template <typename T, typename Compare>
+void unguarded_insertion_sort(T* begin, T* end, Compare& comp) {
+    if (begin == end) return;
+    for (T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift1 = cur - 1;
+        if (comp(*sift, *sift1)) {
+            T tmp = ops::move(*sift);
+            do {
+                *sift-- = ops::move(*sift1);
+            } while (comp(tmp, *--sift1));
+            *sift = ops::move(tmp);
+        }
+    }
+}
+
+// Insertion sort that gives up once it has moved more than
+// kPartialInsertionSortLimit elements; true if the range ended up sorted.
+template <typename T, typename Compare>
+bool partial_insertion_sort(T* begin, T* end, Compare& comp) {
+    if (begin == end) return true;
+    ptrdiff_t moved = 0;
+    for (T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift1 = cur - 1;
+        if (comp(*sift, *sift1)) {
+            T tmp = ops::move(*sift);
+            do {
+                *sift-- = ops::move(*sift1);
+            } while (sift != begin && comp(tmp, *--sift1));
+            *sift = ops::move(tmp);
+            moved += cur - sift;
+        }
+        if (moved > kPartialInsertionSortLimit) return false;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+inline void sort2(T* a, T* b, Compare& comp) {
+    if (comp(*b, *a)) ops::iter_swap(a, b);
+}
+
+template <typename T, typename Compare>
+inline void sort3(T* a, T* b, T* c, Compare& comp) {
+    sort2(a, b, comp);
+    sort2(b, c, comp);
+    sort2(a, b, comp);
+}
+
+template <typename T>
+inline void swap_offsets(T* first, T* last, const unsigned char* offsetsL,
+                         const unsigned char* offsetsR, size_t num, bool useSwaps) {
+    if (useSwaps) {
+        // With equal counts on both sides a cyclic permutation would not
+        // fix up the last element, so swap pairwise.
+        for (size_t i = 0; i < num; ++i) ops::iter_swap(first + offsetsL[i], last - offsetsR[i]);
+    } else if (num > 0) {
+        T* l = first + offsetsL[0];
+        T* r = last - offsetsR[0];
+        T tmp(ops::move(*l));
+        *l = ops::move(*r);
+        for (size_t i = 1; i < num; ++i) {
+            l = first + offsetsL[i];
+            *r = ops::move(*l);
+            r = last - offsetsR[i];
+            *l = ops::move(*r);
+        }
+        *r = ops::move(tmp);
+    }
+}
+
+// Partitions [begin, end) around *begin into [< pivot][pivot][>= pivot].
+// Returns the pivot position and whether the range was already partitioned.
+template <typename T, typename Compare>
+std::pair<T*, bool> partition_right_branchless(T* begin, T* end, Compare& comp) {
+    T pivot(ops::move(*begin));
+    T* first = begin;
+    T* last = end;
+
+    // The median-of-3 guarantees a sentinel on the left; the right needs a
+    // bound check only if the first element already sits in place.
+    while (comp(*++first, pivot)) {}
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {}
+    } else {
+        while (!comp(*--last, pivot)) {}
+    }
+
+    bool alreadyPartitioned = first >= last;
+    if (!alreadyPartitioned) {
+        ops::iter_swap(first, last);
+        ++first;
+
+        // BlockQuicksort: record offsets of misplaced elements for a block
+        // on each side without branching, then swap them in bulk.
+        alignas(kCachelineSize) unsigned char offsetsL[kBlockSize];
+        alignas(kCachelineSize) unsigned char offsetsR[kBlockSize];
+        T* offsetsLBase = first;
+        T* offsetsRBase = last;
+        size_t numL = 0, numR = 0, startL = 0, startR = 0;
+
+        while (first < last) {
+            size_t numUnknown = static_cast<size_t>(last - first);
+            size_t leftSplit = numL == 0 ? (numR == 0 ? numUnknown / 2 : numUnknown) : 0;
+            size_t rightSplit = numR == 0 ? (numUnknown - leftSplit) : 0;
+
+            if (leftSplit >= static_cast<size_t>(kBlockSize)) {
+                for (unsigned char i = 0; i < kBlockSize;) {
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                }
+            } else {
+                for (unsigned char i = 0; i < leftSplit;) {
+                    offsetsL[numL] = i++; numL += !comp(*first, pivot); ++first;
+                }
+            }
+
+            if (rightSplit >= static_cast<size_t>(kBlockSize)) {
+                for (unsigned char i = 0; i < kBlockSize;) {
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                }
+            } else {
+                for (unsigned char i = 0; i < rightSplit;) {
+                    offsetsR[numR] = ++i; numR += comp(*--last, pivot);
+                }
+            }
+
+            size_t num = std::min(numL, numR);
+            swap_offsets(offsetsLBase, offsetsRBase, offsetsL + startL, offsetsR + startR,
+                         num, numL == numR);
+            numL -= num; numR -= num;
+            startL += num; startR += num;
+            if (numL == 0) {
+                startL = 0;
+                offsetsLBase = first;
+            }
+            if (numR == 0) {
+                startR = 0;
+                offsetsRBase = last;
+            }
+        }
+
+        // Whatever is left on one side goes to the boundary.
+        if (numL) {
+            const unsigned char* offs = offsetsL + startL;
+            while (numL--) ops::iter_swap(offsetsLBase + offs[numL], --last);
+            first = last;
+        }
+        if (numR) {
+            const unsigned char* offs = offsetsR + startR;
+            while (numR--) {
+                ops::iter_swap(offsetsRBase - offs[numR], first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+
+    T* pivotPos = first - 1;
+    *begin = ops::move(*pivotPos);
+    *pivotPos = ops::move(pivot);
+    return {pivotPos, alreadyPartitioned};
+}
+
+// Branchy counterpart of partition_right_branchless, for expensive comparators.
+template <typename T, typename Compare>
+std::pair<T*, bool> partition_right(T* begin, T* end, Compare& comp) {
+    T pivot(ops::move(*begin));
+    T* first = begin;
+    T* last = end;
+
+    while (comp(*++first, pivot)) {}
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {}
+    } else {
+        while (!comp(*--last, pivot)) {}
+    }
+
+    bool alreadyPartitioned = first >= last;
+    while (first < last) {
+        ops::iter_swap(first, last);
+        while (comp(*++first, pivot)) {}
+        while (!comp(*--last, pivot)) {}
+    }
+
+    T* pivotPos = first - 1;
+    *begin = ops::move(*pivotPos);
+    *pivotPos = ops::move(pivot);
+    return {pivotPos, alreadyPartitioned};
+}
+
+// Puts everything equal to the pivot on the left: [== pivot][> pivot].
+// Used when the pivot equals the predecessor range's pivot, which makes
+// runs of equal keys cost linear time.
+template <typename T, typename Compare>
+T* partition_left(T* begin, T* end, Compare& comp) {
+    T pivot(ops::move(*begin));
+    T* first = begin;
+    T* last = end;
+
+    while (comp(pivot, *--last)) {}
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first)) {}
+    } else {
+        while (!comp(pivot, *++first)) {}
+    }
+
+    while (first < last) {
+        ops::iter_swap(first, last);
+        while (comp(pivot, *--last)) {}
+        while (!comp(pivot, *++first)) {}
+    }
+
+    T* pivotPos = last;
+    *begin = ops::move(*pivotPos);
+    *pivotPos = ops::move(pivot);
+    return pivotPos;
+}
+
+template <bool Branchless, typename T, typename Compare>
+void sort_loop(T* begin, T* end, Compare& comp, int badAllowed, bool leftmost = true) {
+    while (true) {
+        ptrdiff_t size = end - begin;
+
+        if (size < kInsertionSortThreshold) {
+            if (leftmost) insertion_sort(begin, end, comp);
+            else unguarded_insertion_sort(begin, end, comp);
+            return;
+        }
+
+        // Median of 3 for small ranges, Tukey's ninther for large ones.
+        ptrdiff_t s2 = size / 2;
+        if (size > kNintherThreshold) {
+            sort3(begin, begin + s2, end - 1, comp);
+            sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            ops::iter_swap(begin, begin + s2);
+        } else {
+            sort3(begin + s2, begin, end - 1, comp);
+        }
+
+        // A pivot equal to the element before this range means every
+        // element here is >= pivot: split off the equal ones and move on.
+        if (!leftmost && !comp(*(begin - 1), *begin)) {
+            begin = partition_left(begin, end, comp) + 1;
+            continue;
+        }
+
+        std::pair<T*, bool> part = Branchless ? partition_right_branchless(begin, end, comp)
+                                              : partition_right(begin, end, comp);
+        T* pivotPos = part.first;
+        bool alreadyPartitioned = part.second;
+
+        ptrdiff_t lSize = pivotPos - begin;
+        ptrdiff_t rSize = end - (pivotPos + 1);
+        bool highlyUnbalanced = lSize < size / 8 || rSize < size / 8;
+
+        if (highlyUnbalanced) {
+            // Too many bad partitions: heapsort keeps the O(n log n) bound.
+            if (--badAllowed == 0) {
+                std::make_heap(begin, end, comp);
+                std::sort_heap(begin, end, comp);
+                return;
+            }
+
+            // Otherwise shuffle a few elements to break adversarial patterns.
+            if (lSize >= kInsertionSortThreshold) {
+                ops::iter_swap(begin, begin + lSize / 4);
+                ops::iter_swap(pivotPos - 1, pivotPos - lSize / 4);
+                if (lSize > kNintherThreshold) {
+                    ops::iter_swap(begin + 1, begin + (lSize / 4 + 1));
+                    ops::iter_swap(begin + 2, begin + (lSize / 4 + 2));
+                    ops::iter_swap(pivotPos - 2, pivotPos - (lSize / 4 + 1));
+                    ops::iter_swap(pivotPos - 3, pivotPos - (lSize / 4 + 2));
+                }
+            }
+            if (rSize >= kInsertionSortThreshold) {
+                ops::iter_swap(pivotPos + 1, pivotPos + (1 + rSize / 4));
+                ops::iter_swap(end - 1, end - rSize / 4);
+                if (rSize > kNintherThreshold) {
+                    ops::iter_swap(pivotPos + 2, pivotPos + (2 + rSize / 4));
+                    ops::iter_swap(pivotPos + 3, pivotPos + (3 + rSize / 4));
+                    ops::iter_swap(end - 2, end - (1 + rSize / 4));
+                    ops::iter_swap(end - 3, end - (2 + rSize / 4));
+                }
+            }
+        } else if (alreadyPartitioned && partial_insertion_sort(begin, pivotPos, comp) &&
+                   partial_insertion_sort(pivotPos + 1, end, comp)) {
+            // A balanced partition that moved nothing is a hint the input is
+            // (nearly) sorted; cheap insertion sorts confirm it.
+            return;
+        }
+
+        // Recurse into the left part, loop on the right one.
+        sort_loop<Branchless>(begin, pivotPos, comp, badAllowed, leftmost);
+        begin = pivotPos + 1;
+        leftmost = false;
+    }
+}
+
+template <typename T, typename Compare>
+void sort(T* begin, T* end, Compare& comp) {
+    if (end - begin < 2) return;
+    sort_loop<branchless_compare<T, Compare>::value>(begin, end, comp, log2(static_cast<size_t>(end - begin)));
+}
+
+}
+
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class PdqSorter final : public Sorter<T, Compare> {
+public:
+    using Sorter<T, Compare>::Sorter;
+    std::string name() const override { return "pdqsort"; }
+    void sort(std::vector<T>& a) override { pdq::sort(a.data(), a.data() + a.size(), this->cmp_); }
+};
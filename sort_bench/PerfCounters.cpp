@@ -0,0 +1,129 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* to_string(PerfEvent e) {
+    switch (e) {
+        case PerfEvent::Cycles:       return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::L1dMisses:    return "L1d-misses";
+        case PerfEvent::LlcMisses:    return "LLC-misses";
+        case PerfEvent::BranchMisses: return "branch-misses";
+        case PerfEvent::DtlbMisses:   return "dTLB-misses";
+    }
+    return "unknown";
+}
+
+#if defined(__linux__)
+
+namespace {
+
+struct EventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t cache_miss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Indexed by PerfEvent.
+const EventSpec kSpecs[kPerfEvents] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+int open_event(const EventSpec& spec) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;  // user space only, allowed at perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+}
+
+PerfCounters::PerfCounters() {
+    std::string missing;
+    int err = 0;
+    for (size_t i = 0; i < kPerfEvents; ++i) {
+        fds_[i] = open_event(kSpecs[i]);
+        if (fds_[i] >= 0) {
+            ++opened_;
+            continue;
+        }
+        if (!err) err = errno;
+        missing += missing.empty() ? "" : ", ";
+        missing += to_string(static_cast<PerfEvent>(i));
+    }
+    if (!missing.empty()) {
+        status_ = "perf_event_open failed for " + missing + ": " + std::strerror(err);
+        if (err == EACCES || err == EPERM) status_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool PerfCounters::read(size_t i, Reading& out) const {
+    uint64_t buf[3];
+    if (fds_[i] < 0 || ::read(fds_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) return false;
+    out = {buf[0], buf[1], buf[2]};
+    return true;
+}
+
+// Counters are never reset: a reset would not clear what exited child
+// threads have already folded in, so each region is a difference of reads.
+void PerfCounters::start() {
+    for (size_t i = 0; i < kPerfEvents; ++i) {
+        if (!read(i, begin_[i])) begin_[i] = Reading();
+    }
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample s;
+    for (size_t i = 0; i < kPerfEvents; ++i) {
+        Reading end;
+        if (!read(i, end)) continue;
+        uint64_t running = end.running - begin_[i].running;
+        if (running == 0) continue;  // never scheduled on the PMU in this region
+        double enabled = static_cast<double>(end.enabled - begin_[i].enabled);
+        s.value[i] = static_cast<double>(end.value - begin_[i].value) * enabled / static_cast<double>(running);
+        s.valid[i] = true;
+    }
+    return s;
+}
+
+#else
+
+PerfCounters::PerfCounters() : status_("hardware counters need Linux perf_event_open") {
+    fds_.fill(-1);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::read(size_t, Reading&) const { return false; }
+
+void PerfCounters::start() {}
+
+PerfSample PerfCounters::stop() { return PerfSample(); }
+
+#endif
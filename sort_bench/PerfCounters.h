@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class PerfEvent { Cycles, Instructions, L1dMisses, LlcMisses, BranchMisses, DtlbMisses };
+
+constexpr size_t kPerfEvents = 6;
+
+const char* to_string(PerfEvent e);
+
+// Counter deltas for one measured region; valid[i] is false for events
+// the kernel or CPU does not provide.
+struct PerfSample {
+    std::array<double, kPerfEvents> value{};
+    std::array<bool, kPerfEvents> valid{};
+
+    bool has(PerfEvent e) const { return valid[static_cast<size_t>(e)]; }
+    double operator[](PerfEvent e) const { return value[static_cast<size_t>(e)]; }
+};
+
+// Hardware counters for the calling thread via perf_event_open (Linux
+// only). Threads it spawns are included once they have exited, so
+// parallel_for workers count but long-lived pool workers do not; the
+// runner leaves counters out for sorters that keep threads. Each event
+// is opened on its own, so one the PMU lacks does not take the others
+// down, and multiplexed counts are scaled by enabled/running time. Without
+// perf support (other OSes, containers, perf_event_paranoid, VMs without a
+// virtual PMU) available() is false and samples are empty.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return opened_ > 0; }
+
+    // Why some or all events are missing; empty when all opened.
+    const std::string& status() const { return status_; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    struct Reading {
+        uint64_t value{0};
+        uint64_t enabled{0};
+        uint64_t running{0};
+    };
+
+    bool read(size_t i, Reading& out) const;
+
+    std::array<int, kPerfEvents> fds_;
+    std::array<Reading, kPerfEvents> begin_{};
+    size_t opened_{0};
+    std::string status_;
+};
@@ -0,0 +1,313 @@
+#pragma once
+#include "KeyTypes.h"
+#include "Parallel.h"
+#include "Sorter.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Maps a key to an unsigned integer whose natural order matches the key's
+// ascending order: the sign bit is flipped for signed integers, and for
+// IEEE floats negatives are inverted while positives get the sign bit set.
+template <typename T, typename Enable = void>
+struct RadixKey;
+
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    using Bits = typename std::make_unsigned<T>::type;
+    static Bits bits(T x) {
+        Bits b = static_cast<Bits>(x);
+        if (std::is_signed<T>::value) b ^= Bits(1) << (sizeof(T) * 8 - 1);
+        return b;
+    }
+};
+
+template <>
+struct RadixKey<float> {
+    using Bits = uint32_t;
+    static Bits bits(float x) {
+        uint32_t b;
+        std::memcpy(&b, &x, sizeof(b));
+        return (b & 0x80000000u) ? ~b : (b | 0x80000000u);
+    }
+};
+
+template <>
+struct RadixKey<double> {
+    using Bits = uint64_t;
+    static Bits bits(double x) {
+        uint64_t b;
+        std::memcpy(&b, &x, sizeof(b));
+        return (b & 0x8000000000000000ull) ? ~b : (b | 0x8000000000000000ull);
+    }
+};
+
+template <>
+struct RadixKey<Record> {
+    using Bits = uint64_t;
+    static Bits bits(const Record& r) { return r.key; }
+};
+
+template <size_t Bytes>
+struct RadixKey<WideRecord<Bytes>> {
+    using Bits = uint64_t;
+    static Bits bits(const WideRecord<Bytes>& r) { return r.key; }
+};
+
+// True when RadixKey order is the comparator's order, so a radix sort can
+// stand in for a comparison sort.
+template <typename T, typename Compare>
+struct radix_compatible : std::false_type {};
+
+template <typename T>
+struct radix_compatible<T, std::less<T>> : std::is_arithmetic<T> {};
+
+template <>
+struct radix_compatible<Record, RecordByKey> : std::true_type {};
+
+template <size_t Bytes>
+struct radix_compatible<WideRecord<Bytes>, WideRecordByKey> : std::true_type {};
+
+namespace radix {
+
+constexpr size_t kBuckets = 256;
+constexpr size_t kInsertionCutoff = 64;
+constexpr size_t kParallelMinChunk = 1 << 16;
+constexpr size_t kWriteCombineBytes = 128;
+
+template <typename T>
+constexpr int digit_count() { return static_cast<int>(sizeof(typename RadixKey<T>::Bits)); }
+
+template <typename T>
+inline size_t digit(const T& x, int d) {
+    return static_cast<size_t>((RadixKey<T>::bits(x) >> (d * 8)) & 0xFF);
+}
+
+template <typename T>
+void insertion_sort_by_key(T* a, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        T x = ops::move(a[i]);
+        auto kx = RadixKey<T>::bits(x);
+        size_t j = i;
+        while (j > 0 && ops::less(kx, RadixKey<T>::bits(a[j - 1]))) {
+            a[j] = ops::move(a[j - 1]);
+            --j;
+        }
+        a[j] = ops::move(x);
+    }
+}
+
+// Elements staged per bucket by scatter_write_combined.
+template <typename T>
+constexpr size_t write_combine_count() { return std::max<size_t>(1, kWriteCombineBytes / sizeof(T)); }
+
+// Stable scatter of src[b, e) by digit d. Elements are staged in small
+// per-bucket buffers (`buf`, kBuckets * write_combine_count<T>() elements)
+// and written out a cache line or two at a time, which keeps 256 open
+// output streams from thrashing the TLB on large inputs.
+template <typename T>
+void scatter_write_combined(const T* src, size_t b, size_t e, T* dst, int d, size_t* offsets, T* buf) {
+    constexpr size_t kWc = write_combine_count<T>();
+    size_t fill[kBuckets] = {};
+    ops::moved(2 * (e - b), sizeof(T));
+
+    for (size_t i = b; i < e; ++i) {
+        size_t k = digit(src[i], d);
+        buf[k * kWc + fill[k]] = src[i];
+        if (++fill[k] == kWc) {
+            std::memcpy(dst + offsets[k], &buf[k * kWc], kWc * sizeof(T));
+            offsets[k] += kWc;
+            fill[k] = 0;
+        }
+    }
+    for (size_t k = 0; k < kBuckets; ++k) {
+        if (fill[k]) {
+            std::memcpy(dst + offsets[k], &buf[k * kWc], fill[k] * sizeof(T));
+            offsets[k] += fill[k];
+        }
+    }
+}
+
+// One parallel counting pass by digit d from src into dst. Each chunk
+// counts its own histogram; an exclusive prefix over (bucket, chunk) gives
+// every chunk a private output range per bucket, so chunks scatter without
+// synchronisation and the result stays stable. `hist` holds
+// chunks * kBuckets counts; if `counted` is set it already holds them.
+// `wc` holds one write-combining buffer per chunk.
+template <typename T>
+void parallel_pass(const T* src, T* dst, size_t n, int d, unsigned threads,
+                   size_t* hist, T* wc, bool counted) {
+    const size_t chunks = parallel_chunks(n, threads, kParallelMinChunk);
+
+    if (!counted) {
+        std::fill_n(hist, chunks * kBuckets, 0);
+        parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+            size_t* h = &hist[c * kBuckets];
+            for (size_t i = b; i < e; ++i) ++h[digit(src[i], d)];
+        }, kParallelMinChunk);
+    }
+
+    size_t sum = 0;
+    for (size_t k = 0; k < kBuckets; ++k) {
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t cnt = hist[c * kBuckets + k];
+            hist[c * kBuckets + k] = sum;
+            sum += cnt;
+        }
+    }
+
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        scatter_write_combined(src, b, e, dst, d, &hist[c * kBuckets], wc + c * kBuckets * write_combine_count<T>());
+    }, kParallelMinChunk);
+}
+
+// Sequential MSD step on a bucket currently in `src`. The sorted result
+// ends up in dst if toDst, else in src; buffers swap roles per level so
+// nothing is copied back except at the leaves.
+template <typename T>
+void msd_sort(T* src, T* dst, size_t n, int d, int lowDigit, bool toDst) {
+    if (n <= kInsertionCutoff || d < lowDigit) {
+        if (d >= lowDigit) insertion_sort_by_key(src, n);
+        if (toDst) {
+            std::memcpy(dst, src, n * sizeof(T));
+            ops::moved(n, sizeof(T));
+        }
+        return;
+    }
+
+    size_t cnt[kBuckets] = {};
+    for (size_t i = 0; i < n; ++i) ++cnt[digit(src[i], d)];
+    if (cnt[digit(src[0], d)] == n) {
+        msd_sort(src, dst, n, d - 1, lowDigit, toDst);
+        return;
+    }
+
+    size_t off[kBuckets];
+    size_t sum = 0;
+    for (size_t k = 0; k < kBuckets; ++k) {
+        off[k] = sum;
+        sum += cnt[k];
+    }
+    for (size_t i = 0; i < n; ++i) dst[off[digit(src[i], d)]++] = src[i];
+    ops::moved(n, sizeof(T));
+
+    size_t begin = 0;
+    for (size_t k = 0; k < kBuckets; ++k) {
+        if (cnt[k]) msd_sort(dst + begin, src + begin, cnt[k], d - 1, lowDigit, !toDst);
+        begin += cnt[k];
+    }
+}
+
+// Stable ascending radix sort of a[0, n) in key order (see RadixKey).
+//
+// One parallel counting pass builds the histogram of every digit at once;
+// digits where all keys agree are skipped. If the remaining digits are few
+// compared with log256(n) an LSD sort runs over them, otherwise one
+// parallel MSD pass on the top digit splits the input and the buckets are
+// finished by a sequential MSD sort on a thread pool, switching to
+// insertion sort below kInsertionCutoff. Scratch is borrowed from `ws`
+// when one is given.
+template <typename T>
+void sort(T* a, size_t n, unsigned threads = 0, SortWorkspace* ws = nullptr) {
+    static_assert(std::is_trivially_copyable<T>::value, "radix sort moves raw bytes");
+    if (n <= kInsertionCutoff) {
+        insertion_sort_by_key(a, n);
+        return;
+    }
+
+    constexpr int D = digit_count<T>();
+    const size_t chunks = parallel_chunks(n, threads, kParallelMinChunk);
+    Scratch<size_t> all(ws, chunks * D * kBuckets);
+    std::fill_n(all.data(), chunks * D * kBuckets, 0);
+    ops::scratch(chunks * D * kBuckets * sizeof(size_t));
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        size_t* h = &all[c * D * kBuckets];
+        for (size_t i = b; i < e; ++i) {
+            auto bits = RadixKey<T>::bits(a[i]);
+            for (int d = 0; d < D; ++d) ++h[d * kBuckets + ((bits >> (d * 8)) & 0xFF)];
+        }
+    }, kParallelMinChunk);
+
+    int active[D];
+    size_t activeCount = 0;
+    for (int d = 0; d < D; ++d) {
+        size_t k0 = digit(a[0], d);
+        size_t total = 0;
+        for (size_t c = 0; c < chunks; ++c) total += all[(c * D + d) * kBuckets + k0];
+        if (total != n) active[activeCount++] = d;
+    }
+    if (activeCount == 0) return;
+
+    // MSD needs about one level per factor of 256 above the insertion cutoff.
+    size_t msdLevels = 1;
+    for (size_t m = n / kInsertionCutoff; m > kBuckets; m /= kBuckets) ++msdLevels;
+
+    constexpr size_t kWc = write_combine_count<T>();
+    Scratch<T> tmp(ws, n);
+    Scratch<size_t> hist(ws, chunks * kBuckets);
+    Scratch<T> wc(ws, chunks * kBuckets * kWc);
+    ops::scratch(n * sizeof(T) + chunks * kBuckets * (sizeof(size_t) + kWc * sizeof(T)));
+    auto load_counts = [&](int d) {
+        for (size_t c = 0; c < chunks; ++c) {
+            std::copy_n(&all[(c * D + d) * kBuckets], kBuckets, &hist[c * kBuckets]);
+        }
+    };
+
+    if (activeCount <= msdLevels + 1) {
+        T* src = a;
+        T* dst = tmp.data();
+        for (size_t p = 0; p < activeCount; ++p) {
+            // The first pass still sees the input order, so its per-chunk counts are reusable.
+            if (p == 0) load_counts(active[p]);
+            parallel_pass(src, dst, n, active[p], threads, hist.data(), wc.data(), p == 0);
+            std::swap(src, dst);
+        }
+        if (src != a) {
+            parallel_for(n, threads, [&](size_t b, size_t e, size_t) {
+                std::memcpy(a + b, src + b, (e - b) * sizeof(T));
+            }, kParallelMinChunk);
+            ops::moved(n, sizeof(T));
+        }
+        return;
+    }
+
+    const int top = active[activeCount - 1];
+    const int low = active[0];
+    load_counts(top);
+    size_t cnt[kBuckets] = {};
+    for (size_t c = 0; c < chunks; ++c) {
+        for (size_t k = 0; k < kBuckets; ++k) cnt[k] += hist[c * kBuckets + k];
+    }
+    parallel_pass(a, tmp.data(), n, top, threads, hist.data(), wc.data(), true);
+
+    size_t start[kBuckets];
+    size_t order[kBuckets];
+    size_t buckets = 0;
+    for (size_t k = 0, s = 0; k < kBuckets; s += cnt[k], ++k) {
+        start[k] = s;
+        if (cnt[k]) order[buckets++] = k;
+    }
+    std::sort(order, order + buckets, [&](size_t x, size_t y) { return cnt[x] > cnt[y]; });
+
+    parallel_tasks(buckets, threads, [&](size_t i) {
+        size_t k = order[i];
+        msd_sort(tmp.data() + start[k], a + start[k], cnt[k], top - 1, low, true);
+    });
+}
+
+}
+
+template <typename T>
+class RadixSorter final : public ISorterT<T> {
+public:
+    explicit RadixSorter(unsigned threads = 0) : threads_(threads) {}
+    std::string name() const override { return "Radix"; }
+    bool parallel() const override { return resolve_threads(threads_) > 1; }
+    void sort(std::vector<T>& a) override { radix::sort(a.data(), a.size(), threads_, this->workspace_); }
+
+private:
+    unsigned threads_;
+};
@@ -0,0 +1,667 @@
+#include "Report.h"
+#include "Json.h"
+#include "SimdSort.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#endif
+#if !defined(_WIN32)
+#include <sys/utsname.h>
+#endif
+#if defined(SORT_BENCH_HAVE_GIT_REVISION_H)
+#include "GitRevision.h"  // generated by the CMake build
+#endif
+
+namespace Report {
+
+static double to_ms(double ns) { return ns / 1e6; }
+
+static const char* kBaselineSorter = "std::sort(Introsort)";
+
+static const BenchResult* find_baseline(const std::vector<BenchResult>& results) {
+    for (const auto& r : results) {
+        if (r.sorter == kBaselineSorter && !r.skipped) return &r;
+    }
+    return nullptr;
+}
+
+static bool any_perf(const std::vector<BenchResult>& results) {
+    for (const auto& r : results) {
+        if (r.perf.available) return true;
+    }
+    return false;
+}
+
+static bool any_rss(const std::vector<BenchResult>& results) {
+    for (const auto& r : results) {
+        if (r.mem.rss) return true;
+    }
+    return false;
+}
+
+static double to_kb(uint64_t bytes) { return bytes / 1024.0; }
+
+// Results the runner did not measure because they were predicted to
+// overrun the cell budget are marked apart from unsupported inputs.
+static const char* skip_label(const BenchResult& r) { return r.extrapolated ? "extrapolated" : "skipped"; }
+
+// Per-element count of one event, or "-" where the PMU does not provide it.
+static void print_per_element(const PerfSummary& p, PerfEvent e) {
+    if (p.perElement.has(e)) std::cout << std::setprecision(3) << std::setw(10) << p.perElement[e];
+    else std::cout << std::setw(10) << "-";
+}
+
+void print(int n, int repeats, const std::vector<BenchResult>& results) {
+    const bool perf = any_perf(results);
+    const bool rss = any_rss(results);
+    std::cout << "\nN = " << n << " (min repeats " << repeats << ")\n";
+    std::cout << std::left << std::setw(24) << "Sorter"
+              << std::right << std::setw(6) << "runs"
+              << std::setw(12) << "min ms"
+              << std::setw(12) << "median ms"
+              << std::setw(12) << "p90 ms"
+              << std::setw(12) << "MAD ms"
+              << std::setw(10) << "+-CI%"
+              << std::setw(12) << "ns/elem"
+              << std::setw(12) << "x std::sort";
+    if (perf) {
+        std::cout << std::setw(7) << "IPC"
+                  << std::setw(10) << "L1d/el"
+                  << std::setw(10) << "LLC/el"
+                  << std::setw(10) << "br/el"
+                  << std::setw(10) << "dTLB/el";
+    }
+    if (ops::kEnabled) {
+        std::cout << std::setw(14) << "compares"
+                  << std::setw(14) << "swaps"
+                  << std::setw(14) << "moves"
+                  << std::setw(12) << "moved MB"
+                  << std::setw(12) << "scratch KB";
+    }
+    if (alloc::kEnabled) {
+        std::cout << std::setw(10) << "allocs"
+                  << std::setw(12) << "alloc KB"
+                  << std::setw(12) << "peak KB";
+    }
+    if (rss) std::cout << std::setw(12) << "RSS+ KB";
+    std::cout << "\n";
+
+    const BenchResult* base = find_baseline(results);
+    std::cout << std::fixed;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(24) << r.sorter << std::right;
+        if (r.skipped) {
+            std::cout << "  " << skip_label(r) << ": " << r.reason << "\n";
+            continue;
+        }
+        const RunStats& s = r.stats;
+        double ciPct = s.medianNs > 0 ? 100.0 * s.ciHalfWidthNs / s.medianNs : 0.0;
+        std::cout << std::setw(6) << s.samples
+                  << std::setprecision(3)
+                  << std::setw(12) << to_ms(s.minNs)
+                  << std::setw(12) << to_ms(s.medianNs)
+                  << std::setw(12) << to_ms(s.p90Ns)
+                  << std::setw(12) << to_ms(s.madNs)
+                  << std::setprecision(2)
+                  << std::setw(10) << ciPct
+                  << std::setw(12) << r.nsPerElement;
+        if (base && s.medianNs > 0) std::cout << std::setw(12) << base->stats.medianNs / s.medianNs;
+        else std::cout << std::setw(12) << "-";
+        if (perf) {
+            if (r.perf.ipc > 0) std::cout << std::setw(7) << r.perf.ipc;
+            else std::cout << std::setw(7) << "-";
+            print_per_element(r.perf, PerfEvent::L1dMisses);
+            print_per_element(r.perf, PerfEvent::LlcMisses);
+            print_per_element(r.perf, PerfEvent::BranchMisses);
+            print_per_element(r.perf, PerfEvent::DtlbMisses);
+        }
+        if (ops::kEnabled) {
+            std::cout << std::setw(14) << r.ops.comparisons
+                      << std::setw(14) << r.ops.swaps
+                      << std::setw(14) << r.ops.moves
+                      << std::setprecision(1)
+                      << std::setw(12) << r.ops.movedBytes / (1024.0 * 1024.0)
+                      << std::setw(12) << r.ops.scratchBytes / 1024.0;
+        }
+        if (alloc::kEnabled && r.mem.measured) {
+            std::cout << std::setw(10) << r.mem.allocations
+                      << std::setprecision(1)
+                      << std::setw(12) << to_kb(r.mem.bytes)
+                      << std::setw(12) << to_kb(r.mem.peakHeapBytes);
+        } else if (alloc::kEnabled) {
+            std::cout << std::setw(10) << "-" << std::setw(12) << "-" << std::setw(12) << "-";
+        }
+        if (rss) {
+            if (r.mem.rss) std::cout << std::setprecision(1) << std::setw(12) << to_kb(r.mem.peakRssBytes);
+            else std::cout << std::setw(12) << "-";
+        }
+        if (!r.verified) std::cout << "  FAILED: " << r.reason;
+        if (r.capped) std::cout << "  (runs capped by the cell budget)";
+        if (!r.note.empty()) std::cout << "  [" << r.note << "]";
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void printRate(const std::string& unit, double items, const std::vector<BenchResult>& results) {
+    std::cout << std::left << std::setw(24) << "Sorter"
+              << std::right << std::setw(14) << ("M " + unit + "/s")
+              << std::setw(14) << ("ns/" + unit) << "\n";
+    std::cout << std::fixed;
+    for (const auto& r : results) {
+        if (r.skipped || r.stats.medianNs <= 0) continue;
+        std::cout << std::left << std::setw(24) << r.sorter << std::right << std::setprecision(2)
+                  << std::setw(14) << items / r.stats.medianNs * 1e3
+                  << std::setw(14) << r.stats.medianNs / items << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void printScaling(int n, const std::vector<ScalingPoint>& points) {
+    if (points.empty()) return;
+
+    std::cout << "\nThread scaling, N = " << n << "\n";
+    std::cout << std::left << std::setw(24) << "Sorter"
+              << std::right << std::setw(9) << "threads"
+              << std::setw(12) << "median ms"
+              << std::setw(12) << "M elem/s"
+              << std::setw(10) << "speedup"
+              << std::setw(12) << "efficiency" << "\n";
+
+    std::cout << std::fixed;
+    const auto& base = points.front().results;
+    for (size_t s = 0; s < base.size(); ++s) {
+        for (const ScalingPoint& p : points) {
+            const BenchResult& r = p.results[s];
+            std::cout << std::left << std::setw(24) << r.sorter << std::right
+                      << std::setw(9) << p.threads;
+            if (r.skipped || base[s].skipped) {
+                std::cout << "  " << skip_label(r) << ": " << r.reason << "\n";
+                continue;
+            }
+            double speedup = r.stats.medianNs > 0 ? base[s].stats.medianNs / r.stats.medianNs : 0.0;
+            double efficiency = speedup * points.front().threads / p.threads;
+            std::cout << std::setprecision(3) << std::setw(12) << to_ms(r.stats.medianNs)
+                      << std::setprecision(1) << std::setw(12) << n / r.stats.medianNs * 1e3
+                      << std::setprecision(2) << std::setw(10) << speedup
+                      << std::setw(11) << 100.0 * efficiency << "%";
+            if (!r.verified) std::cout << "  FAILED: " << r.reason;
+            std::cout << "\n";
+        }
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void printSockets(int n, const std::vector<SocketPoint>& points) {
+    if (points.empty()) return;
+
+    std::cout << "\nPer socket, N = " << n << "\n";
+    std::cout << std::left << std::setw(24) << "Sorter"
+              << std::right << std::setw(6) << "node"
+              << std::setw(9) << "threads"
+              << std::setw(12) << "median ms"
+              << std::setw(12) << "M elem/s" << "\n";
+
+    std::cout << std::fixed;
+    for (const SocketPoint& p : points) {
+        const BenchResult& r = p.result;
+        std::cout << std::left << std::setw(24) << r.sorter << std::right
+                  << std::setw(6) << p.node << std::setw(9) << p.threads;
+        if (r.skipped) {
+            std::cout << "  " << skip_label(r) << ": " << r.reason << "\n";
+            continue;
+        }
+        std::cout << std::setprecision(3) << std::setw(12) << to_ms(r.stats.medianNs)
+                  << std::setprecision(1) << std::setw(12) << n / r.stats.medianNs * 1e3;
+        if (!r.verified) std::cout << "  FAILED: " << r.reason;
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void printExternal(const std::string& input, uint64_t bytes, size_t memoryBytes,
+                   const std::vector<ExternalPoint>& points) {
+    std::cout << "\nExternal sort of " << input << ": " << bytes / (1 << 20) << " MB, memory budget "
+              << memoryBytes / (1 << 20) << " MB\n";
+    std::cout << std::left << std::setw(24) << "Run sorter"
+              << std::right << std::setw(7) << "runs"
+              << std::setw(8) << "fan-in"
+              << std::setw(8) << "passes"
+              << std::setw(10) << "runs s"
+              << std::setw(10) << "merge s"
+              << std::setw(10) << "total s"
+              << std::setw(10) << "MB/s" << "\n";
+
+    std::cout << std::fixed;
+    for (const ExternalPoint& p : points) {
+        std::cout << std::left << std::setw(24) << p.sorter << std::right;
+        if (!p.error.empty()) {
+            std::cout << "  failed: " << p.error << "\n";
+            continue;
+        }
+        const ExternalSortStats& s = p.stats;
+        std::cout << std::setw(7) << s.runs
+                  << std::setw(8) << s.fanIn
+                  << std::setw(8) << s.mergePasses
+                  << std::setprecision(2)
+                  << std::setw(10) << s.runSeconds
+                  << std::setw(10) << s.mergeSeconds
+                  << std::setw(10) << s.seconds()
+                  << std::setprecision(1)
+                  << std::setw(10) << s.mbPerSec();
+        if (!p.verified) std::cout << "  FAILED: output is not the sorted input";
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+
+static std::string trim(std::string s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+// The revision the build recorded in SORT_BENCH_GIT_REV (the CMake build
+// writes it to GitRevision.h on every build); a binary built without it
+// says "unknown" rather than reporting whatever is checked out when it
+// runs.
+static std::string git_revision() {
+#if defined(SORT_BENCH_GIT_REV)
+    return SORT_BENCH_GIT_REV;
+#else
+    return "unknown";
+#endif
+}
+
+static std::string compiler_name() {
+#if defined(__clang__)
+    return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+    return "unknown";
+#endif
+}
+
+static std::string build_flags() {
+    std::string b;
+#if defined(__OPTIMIZE__) || (defined(_MSC_VER) && !defined(_DEBUG))
+    b = "optimized";
+#else
+    b = "unoptimized";
+#endif
+#if defined(NDEBUG)
+    b += ", NDEBUG";
+#endif
+#if defined(__AVX512F__)
+    b += ", avx512f";
+#elif defined(__AVX2__)
+    b += ", avx2";
+#endif
+    if (ops::kEnabled) b += ", count-ops";
+    return b;
+}
+
+static std::string cpu_name() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    unsigned regs[12];
+    if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+        for (unsigned i = 0; i < 3; ++i) {
+            __get_cpuid(0x80000002 + i, &regs[4 * i], &regs[4 * i + 1], &regs[4 * i + 2], &regs[4 * i + 3]);
+        }
+        char brand[49] = {};
+        std::memcpy(brand, regs, 48);
+        return trim(brand);
+    }
+#endif
+    std::ifstream in("/proc/cpuinfo");
+    for (std::string line; std::getline(in, line);) {
+        if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) return trim(line.substr(colon + 1));
+        }
+    }
+    return "unknown";
+}
+
+static std::string os_name() {
+#if defined(_WIN32)
+    return "Windows";
+#else
+    utsname u;
+    if (uname(&u) != 0) return "unknown";
+    return std::string(u.sysname) + " " + u.release + " " + u.machine;
+#endif
+}
+
+Metadata collectMetadata(const BenchmarkRunner& runner) {
+    Metadata m;
+    char buf[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    m.timestamp = buf;
+    m.gitRevision = git_revision();
+    m.compiler = compiler_name();
+    m.build = build_flags();
+    m.cpu = cpu_name();
+    m.logicalCpus = std::thread::hardware_concurrency();
+    m.os = os_name();
+    m.simd = to_string(simd_level());
+    m.config = runner.config();
+    m.pinned = runner.pinned();
+    m.perfCounters = runner.perfCounters();
+    return m;
+}
+
+static const char* bool_str(bool b) { return b ? "true" : "false"; }
+
+bool writeJson(const std::string& path, const Metadata& meta, const std::vector<Entry>& entries,
+               std::string& error) {
+    std::ofstream out(path);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out << std::setprecision(10);
+    const BenchConfig& c = meta.config;
+    out << "{\n  \"tool\": \"sort_bench\",\n  \"format\": 1,\n"
+        << "  \"timestamp\": " << json::quote(meta.timestamp) << ",\n"
+        << "  \"git\": " << json::quote(meta.gitRevision) << ",\n"
+        << "  \"compiler\": " << json::quote(meta.compiler) << ",\n"
+        << "  \"build\": " << json::quote(meta.build) << ",\n"
+        << "  \"host\": {\"cpu\": " << json::quote(meta.cpu) << ", \"logicalCpus\": " << meta.logicalCpus
+        << ", \"os\": " << json::quote(meta.os) << ", \"simd\": " << json::quote(meta.simd) << "},\n"
+        << "  \"config\": {\"repeats\": " << c.repeats << ", \"maxRepeats\": " << c.maxRepeats
+        << ", \"warmup\": " << c.warmup << ", \"cellBudgetSec\": " << c.cellBudgetSec << ", \"ciTarget\": " << c.ciTarget
+        << ", \"timeBudgetSec\": " << c.timeBudgetSec << ", \"pinCpu\": " << c.pinCpu
+        << ", \"pinned\": " << bool_str(meta.pinned) << ", \"perfCounters\": " << bool_str(meta.perfCounters) << "},\n"
+        << "  \"results\": [";
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& e = entries[i];
+        const BenchResult& r = e.result;
+        const RunStats& s = r.stats;
+        out << (i ? "," : "") << "\n    {\"key\": " << json::quote(e.key) << ", \"pattern\": " << json::quote(e.pattern)
+            << ", \"threads\": " << e.threads << ", \"sorter\": " << json::quote(r.sorter) << ", \"n\": " << r.n
+            << ", \"skipped\": " << bool_str(r.skipped) << ", \"verified\": " << bool_str(r.verified)
+            << ", \"extrapolated\": " << bool_str(r.extrapolated) << ", \"capped\": " << bool_str(r.capped)
+            << ", \"predictedNs\": " << r.predictedNs
+            << ", \"reason\": " << json::quote(r.reason) << ", \"note\": " << json::quote(r.note)
+            << ",\n     \"stats\": {\"samples\": " << s.samples << ", \"minNs\": " << s.minNs
+            << ", \"medianNs\": " << s.medianNs << ", \"p90Ns\": " << s.p90Ns << ", \"meanNs\": " << s.meanNs
+            << ", \"stddevNs\": " << s.stddevNs << ", \"madNs\": " << s.madNs << ", \"ciHalfWidthNs\": " << s.ciHalfWidthNs
+            << ", \"nsPerElement\": " << r.nsPerElement << ",\n      \"samplesNs\": [";
+        for (size_t k = 0; k < r.samplesNs.size(); ++k) out << (k ? ", " : "") << r.samplesNs[k];
+        out << "]}";
+        if (r.perf.available) {
+            out << ",\n     \"perf\": {\"ipc\": " << r.perf.ipc;
+            for (size_t k = 0; k < kPerfEvents; ++k) {
+                out << ", " << json::quote(to_string(static_cast<PerfEvent>(k))) << ": ";
+                if (r.perf.perElement.valid[k]) out << r.perf.perElement.value[k];
+                else out << "null";
+            }
+            out << "}";
+        }
+        if (ops::kEnabled) {
+            out << ",\n     \"ops\": {\"comparisons\": " << r.ops.comparisons << ", \"swaps\": " << r.ops.swaps
+                << ", \"moves\": " << r.ops.moves << ", \"movedBytes\": " << r.ops.movedBytes
+                << ", \"scratchBytes\": " << r.ops.scratchBytes << "}";
+        }
+        if (alloc::kEnabled && r.mem.measured) {
+            out << ",\n     \"memory\": {\"allocations\": " << r.mem.allocations << ", \"bytes\": " << r.mem.bytes
+                << ", \"peakHeapBytes\": " << r.mem.peakHeapBytes << ", \"peakRssBytes\": ";
+            if (r.mem.rss) out << r.mem.peakRssBytes;
+            else out << "null";
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out) {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+static std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string q = "\"";
+    for (char c : s) q += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return q + "\"";
+}
+
+bool writeCsv(const std::string& path, const Metadata& meta, const std::vector<Entry>& entries,
+              std::string& error) {
+    std::ofstream out(path);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out << std::setprecision(10);
+    // Run metadata as leading comment lines; most CSV readers can skip them.
+    out << "# git: " << meta.gitRevision << "\n# timestamp: " << meta.timestamp
+        << "\n# compiler: " << meta.compiler << "\n# build: " << meta.build
+        << "\n# cpu: " << meta.cpu << " (" << meta.logicalCpus << " logical)\n# os: " << meta.os
+        << "\n# simd: " << meta.simd << "\n";
+
+    out << "key,pattern,threads,sorter,n,skipped,verified,extrapolated,capped,predicted_ns,samples,min_ns,median_ns,p90_ns,mean_ns,"
+           "stddev_ns,mad_ns,ci_half_width_ns,ns_per_element,ipc";
+    for (size_t k = 0; k < kPerfEvents; ++k) {
+        std::string name = to_string(static_cast<PerfEvent>(k));
+        for (char& ch : name) ch = ch == '-' ? '_' : static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        out << "," << name << "_per_element";
+    }
+    if (ops::kEnabled) out << ",comparisons,swaps,moves,moved_bytes,scratch_bytes";
+    if (alloc::kEnabled) out << ",allocations,allocated_bytes,peak_heap_bytes,peak_rss_bytes";
+    out << ",note,reason\n";
+
+    for (const Entry& e : entries) {
+        const BenchResult& r = e.result;
+        const RunStats& s = r.stats;
+        out << csv_field(e.key) << "," << csv_field(e.pattern) << "," << e.threads << "," << csv_field(r.sorter)
+            << "," << r.n << "," << r.skipped << "," << r.verified << "," << r.extrapolated << "," << r.capped
+            << "," << r.predictedNs << "," << s.samples << "," << s.minNs
+            << "," << s.medianNs << "," << s.p90Ns << "," << s.meanNs << "," << s.stddevNs << "," << s.madNs << ","
+            << s.ciHalfWidthNs << "," << r.nsPerElement << ",";
+        if (r.perf.ipc > 0) out << r.perf.ipc;
+        for (size_t k = 0; k < kPerfEvents; ++k) {
+            out << ",";
+            if (r.perf.perElement.valid[k]) out << r.perf.perElement.value[k];
+        }
+        if (ops::kEnabled) {
+            out << "," << r.ops.comparisons << "," << r.ops.swaps << "," << r.ops.moves << "," << r.ops.movedBytes
+                << "," << r.ops.scratchBytes;
+        }
+        if (alloc::kEnabled && r.mem.measured) {
+            out << "," << r.mem.allocations << "," << r.mem.bytes << "," << r.mem.peakHeapBytes << ",";
+            if (r.mem.rss) out << r.mem.peakRssBytes;
+        } else if (alloc::kEnabled) {
+            out << ",,,,";
+        }
+        out << "," << csv_field(r.note) << "," << csv_field(r.reason) << "\n";
+    }
+    if (!out) {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readJson(const std::string& path, std::vector<Entry>& entries, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+
+    json::Value doc;
+    if (!json::parse(text.str(), doc, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    const json::Value* results = doc.find("results");
+    if (doc.str("tool") != "sort_bench" || !results || results->type != json::Value::Type::Array) {
+        error = path + ": not a sort_bench results file";
+        return false;
+    }
+
+    entries.clear();
+    for (const json::Value& v : results->items) {
+        Entry e;
+        e.key = v.str("key");
+        e.pattern = v.str("pattern");
+        e.threads = static_cast<unsigned>(v.num("threads"));
+        BenchResult& r = e.result;
+        r.sorter = v.str("sorter");
+        r.n = static_cast<size_t>(v.num("n"));
+        r.skipped = v.flag("skipped");
+        r.verified = v.flag("verified");
+        r.extrapolated = v.flag("extrapolated");
+        r.capped = v.flag("capped");
+        r.predictedNs = v.num("predictedNs");
+        r.reason = v.str("reason");
+        r.note = v.str("note");
+        if (const json::Value* s = v.find("stats")) {
+            r.stats.samples = static_cast<int>(s->num("samples"));
+            r.stats.minNs = s->num("minNs");
+            r.stats.medianNs = s->num("medianNs");
+            r.stats.p90Ns = s->num("p90Ns");
+            r.stats.meanNs = s->num("meanNs");
+            r.stats.stddevNs = s->num("stddevNs");
+            r.stats.madNs = s->num("madNs");
+            r.stats.ciHalfWidthNs = s->num("ciHalfWidthNs");
+            r.nsPerElement = s->num("nsPerElement");
+            if (const json::Value* samples = s->find("samplesNs")) {
+                for (const json::Value& x : samples->items) r.samplesNs.push_back(x.number);
+            }
+        }
+        entries.push_back(std::move(e));
+    }
+    return true;
+}
+
+static bool same_case(const Entry& a, const Entry& b) {
+    return a.key == b.key && a.pattern == b.pattern && a.threads == b.threads &&
+           a.result.sorter == b.result.sorter && a.result.n == b.result.n;
+}
+
+// One-sided Mann-Whitney U test at 95%: true if cur's times tend to be
+// larger than base's. Ties get mid-ranks and the normal approximation
+// is corrected for them; samples that are all equal are never slower.
+static bool mann_whitney_slower(const std::vector<double>& base, const std::vector<double>& cur) {
+    std::vector<std::pair<double, bool>> all;  // (time, from cur)
+    all.reserve(base.size() + cur.size());
+    for (double x : base) all.push_back({x, false});
+    for (double x : cur) all.push_back({x, true});
+    std::sort(all.begin(), all.end());
+
+    double rankSum = 0;  // of cur's samples
+    double ties = 0;     // sum of t^3 - t over groups of t equal times
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) ++j;
+        const double rank = 0.5 * static_cast<double>(i + 1 + j);
+        for (size_t k = i; k < j; ++k) {
+            if (all[k].second) rankSum += rank;
+        }
+        const double t = static_cast<double>(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    const double nb = static_cast<double>(base.size());
+    const double nc = static_cast<double>(cur.size());
+    const double n = nb + nc;
+    const double u = rankSum - nc * (nc + 1) / 2;  // pairs with cur slower, ties counted half
+    const double var = nb * nc / 12.0 * (n + 1 - ties / (n * (n - 1)));
+    if (var <= 0) return false;
+    return (u - nb * nc / 2 - 0.5) / std::sqrt(var) > 1.645;
+}
+
+int compareBaseline(const std::vector<Entry>& baseline, const std::vector<Entry>& current,
+                    double minSlowdown) {
+    std::cout << "\nBaseline comparison (regression: median >= " << std::setprecision(3) << 100.0 * minSlowdown
+              << "% slower and Mann-Whitney significant at 95%, or median only with under 2 samples)\n";
+    std::cout << std::left << std::setw(24) << "Sorter" << std::setw(10) << "key" << std::setw(15) << "pattern"
+              << std::right << std::setw(9) << "threads" << std::setw(10) << "N"
+              << std::setw(12) << "base ms" << std::setw(12) << "now ms" << std::setw(10) << "change" << "\n";
+
+    int regressions = 0;
+    size_t unmatched = 0;
+    std::cout << std::fixed;
+    for (const Entry& cur : current) {
+        // An extrapolated cell is compared by its predicted time, so a
+        // slowdown that pushes a case over the cell budget still fails.
+        const bool predicted = cur.result.extrapolated && cur.result.predictedNs > 0;
+        if (cur.result.skipped && !predicted) continue;
+        // A wrong result fails however fast it was.
+        const bool wrong = !cur.result.skipped && !cur.result.verified;
+        const Entry* base = nullptr;
+        for (const Entry& b : baseline) {
+            if (same_case(b, cur) && !b.result.skipped) {
+                base = &b;
+                break;
+            }
+        }
+        if (!base && wrong) {
+            ++regressions;
+            std::cout << std::left << std::setw(24) << cur.result.sorter << std::setw(10) << cur.key
+                      << std::setw(15) << cur.pattern << std::right << std::setw(9) << cur.threads
+                      << std::setw(10) << cur.result.n << "  FAILED verification\n";
+            continue;
+        }
+        if (!base) {
+            ++unmatched;
+            continue;
+        }
+        const RunStats& bs = base->result.stats;
+        const RunStats& cs = cur.result.stats;
+        const std::vector<double>& bSamples = base->result.samplesNs;
+        const std::vector<double>& cSamples = cur.result.samplesNs;
+        const double nowNs = predicted ? cur.result.predictedNs : cs.medianNs;
+        double change = bs.medianNs > 0 ? nowNs / bs.medianNs - 1.0 : 0.0;
+        // Without two samples on each side (a predicted time, runs capped
+        // by the cell budget, or a baseline saved without its samples)
+        // there is nothing to rank, so the median change decides alone.
+        const bool medianOnly = predicted || bSamples.size() < 2 || cSamples.size() < 2;
+        const char* basis = predicted ? " (predicted)" : medianOnly ? " (median only)" : "";
+        std::string verdict;
+        if (wrong) {
+            verdict = "  FAILED verification";
+            ++regressions;
+        } else if (change >= minSlowdown && (medianOnly || mann_whitney_slower(bSamples, cSamples))) {
+            verdict = std::string("  REGRESSION") + basis;
+            ++regressions;
+        } else if (-change >= minSlowdown && (medianOnly || mann_whitney_slower(cSamples, bSamples))) {
+            verdict = std::string("  improved") + basis;
+        }
+        std::cout << std::left << std::setw(24) << cur.result.sorter << std::setw(10) << cur.key
+                  << std::setw(15) << cur.pattern << std::right << std::setw(9) << cur.threads
+                  << std::setw(10) << cur.result.n << std::setprecision(3)
+                  << std::setw(12) << to_ms(bs.medianNs) << std::setw(12) << to_ms(nowNs)
+                  << std::setprecision(1) << std::setw(9) << 100.0 * change << "%" << verdict << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    if (unmatched) std::cout << unmatched << " result(s) have no baseline entry\n";
+    std::cout << regressions << " regression(s)\n";
+    return regressions;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "BenchmarkRunner.h"
+#include "ExternalSort.h"
+#include <string>
+#include <vector>
+
+namespace Report {
+
+void print(int n, int repeats, const std::vector<BenchResult>& results);
+
+// Throughput at the median time, for runs that each process `items` of
+// something other than elements (segments, ticks).
+void printRate(const std::string& unit, double items, const std::vector<BenchResult>& results);
+
+// One result set per thread count; speedup is relative to the first entry.
+struct ScalingPoint {
+    unsigned threads;
+    std::vector<BenchResult> results;
+};
+
+void printScaling(int n, const std::vector<ScalingPoint>& points);
+
+// One sorter run with every thread on one NUMA node.
+struct SocketPoint {
+    int node;
+    unsigned threads;
+    BenchResult result;
+};
+
+void printSockets(int n, const std::vector<SocketPoint>& points);
+
+// One external sort of the same input, with `sorter` generating the runs.
+struct ExternalPoint {
+    std::string sorter;
+    ExternalSortStats stats;
+    bool verified{false};
+    std::string error;
+};
+
+void printExternal(const std::string& input, uint64_t bytes, size_t memoryBytes,
+                   const std::vector<ExternalPoint>& points);
+
+// A sweep or scaling result with the input it was measured on.
+struct Entry {
+    std::string key;
+    std::string pattern;
+    unsigned threads{0};  // scaling runs; 0 = the sorter's default
+    BenchResult result;
+};
+
+// Build, host and run settings written alongside the results.
+struct Metadata {
+    std::string timestamp;  // UTC, ISO 8601
+    std::string gitRevision;
+    std::string compiler;
+    std::string build;      // optimisation, NDEBUG, ISA baseline, op counting
+    std::string cpu;
+    unsigned logicalCpus{0};
+    std::string os;
+    std::string simd;
+    BenchConfig config;
+    bool pinned{false};
+    bool perfCounters{false};
+};
+
+Metadata collectMetadata(const BenchmarkRunner& runner);
+
+bool writeJson(const std::string& path, const Metadata& meta, const std::vector<Entry>& entries,
+               std::string& error);
+bool writeCsv(const std::string& path, const Metadata& meta, const std::vector<Entry>& entries,
+              std::string& error);
+
+// Reads the entries of a file written by writeJson.
+bool readJson(const std::string& path, std::vector<Entry>& entries, std::string& error);
+
+// Matches entries by (key, pattern, threads, sorter, n) and prints the
+// change in median time. A regression is a median slowdown of at least
+// minSlowdown (a fraction) that a one-sided Mann-Whitney U test on the
+// run times also finds significant at 95%; with fewer than 2 samples on
+// either side the median change decides alone. A current result extrapolated past
+// the cell budget is compared by its predicted time. A current result
+// that failed verification counts as a regression whatever its time.
+// Returns the number of regressions.
+int compareBaseline(const std::vector<Entry>& baseline, const std::vector<Entry>& current,
+                    double minSlowdown);
+
+}
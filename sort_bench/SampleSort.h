@@ -0,0 +1,276 @@
+#pragma once
+#include "Numa.h"
+#include "PdqSort.h"
+#include "RadixSort.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Parallel sample sort. A sorted random sample, oversampled by about
+// log2(n) / 5 per bucket, gives up to kMaxBuckets - 1 splitters, stored
+// as an implicit binary tree (Eytzinger order) so that classifying an
+// element is log2(buckets) steps of i = 2i + (splitter[i] < x) with no
+// branch on the data; kUnroll elements descend together so their loads
+// overlap, as in IPS4o. When the sample repeats a splitter every splitter
+// gets an equality bucket beside it, which needs no sorting, so heavy
+// duplicates cannot pile up in one bucket.
+//
+// Unlike IPS4o the partition is out of place and one level deep. Each
+// thread classifies a stripe of the input and counts its buckets; the
+// buckets are then split into contiguous ranges, one per NUMA node in
+// proportion to the node's threads, and the scatter writes every bucket
+// straight into its node's arena (see numa::NodeArenas). That scatter is
+// the only pass that crosses the interconnect: each node's threads then
+// sort their own buckets in local memory, largest first, with the best
+// sequential routine for the bucket, and stream the result back to the
+// input.
+namespace sample {
+
+constexpr size_t kMaxBuckets = 256;
+constexpr size_t kBucketTarget = size_t(1) << 12;   // elements per bucket the bucket count aims for
+constexpr size_t kSequentialMax = size_t(1) << 14;  // below this the input is sorted in one piece
+constexpr size_t kParallelMinChunk = 1 << 16;       // elements per thread
+constexpr size_t kRadixMin = size_t(1) << 12;       // buckets from this size are radix sorted when the key allows
+constexpr size_t kUnroll = 8;
+
+using Bucket = uint16_t;
+
+// Splitter tree over buckets() buckets. tree[1, k) is in Eytzinger order;
+// sorted[0, k - 1) holds the same splitters in order for the equality
+// test, padded with the largest so that trailing buckets stay empty.
+template <typename T>
+struct Classifier {
+    const T* tree;
+    const T* sorted;
+    size_t k;
+    unsigned levels;
+    bool equality;
+
+    size_t buckets() const { return equality ? 2 * k : k; }
+
+    template <typename Compare>
+    Bucket finish(size_t i, const T& x, Compare& cmp) const {
+        const size_t b = i - k;
+        if (!equality) return static_cast<Bucket>(b);
+        const bool eq = b + 1 < k && !cmp(x, sorted[b]);
+        return static_cast<Bucket>(2 * b + eq);
+    }
+
+    // Writes the bucket of each x[0, n) to out.
+    template <typename Compare>
+    void classify(const T* x, size_t n, Bucket* out, Compare& cmp) const {
+        size_t i = 0;
+        for (; i + kUnroll <= n; i += kUnroll) {
+            size_t idx[kUnroll];
+            for (size_t j = 0; j < kUnroll; ++j) idx[j] = 1;
+            for (unsigned l = 0; l < levels; ++l) {
+                for (size_t j = 0; j < kUnroll; ++j) idx[j] = 2 * idx[j] + cmp(tree[idx[j]], x[i + j]);
+            }
+            for (size_t j = 0; j < kUnroll; ++j) out[i + j] = finish(idx[j], x[i + j], cmp);
+        }
+        for (; i < n; ++i) {
+            size_t idx = 1;
+            for (unsigned l = 0; l < levels; ++l) idx = 2 * idx + cmp(tree[idx], x[i]);
+            out[i] = finish(idx, x[i], cmp);
+        }
+    }
+};
+
+// Fills tree[1, k) in Eytzinger order from sorted[0, k - 1).
+template <typename T>
+void build_tree(T* tree, const T* sorted, size_t i, size_t k, size_t& next) {
+    if (i >= k) return;
+    build_tree(tree, sorted, 2 * i, k, next);
+    tree[i] = sorted[next++];
+    build_tree(tree, sorted, 2 * i + 1, k, next);
+}
+
+// Sorts a[0, n) on one thread. tmp holds n elements, used only by radix sort.
+template <typename T, typename Compare, typename Counted>
+void sort_sequential(T* a, T* tmp, size_t n, Counted& cmp) {
+    if constexpr (radix_compatible<T, Compare>::value) {
+        if (n >= kRadixMin) {
+            radix::msd_sort(a, tmp, n, radix::digit_count<T>() - 1, 0, false);
+            return;
+        }
+    }
+    pdq::sort(a, a + n, cmp);
+}
+
+// Sorts a[0, n) on the threads of `place` (see numa::place_threads),
+// pinning them to their nodes when `pin`. Bucket data lives in `arenas`;
+// the sample, tree, counts and bucket ids are borrowed from ws if given.
+template <typename T, typename Compare, typename Counted>
+void sort(T* a, size_t n, Counted& cmp, std::vector<size_t> place, bool pin, numa::NodeArenas& arenas,
+          SortWorkspace* ws = nullptr) {
+    constexpr bool kRadix = radix_compatible<T, Compare>::value;
+    if (n < kSequentialMax) {
+        Scratch<T> tmp(ws, kRadix ? n : 0);
+        sort_sequential<T, Compare>(a, tmp.data(), n, cmp);
+        return;
+    }
+    place.resize(std::max<size_t>(1, std::min(place.size(), n / kParallelMinChunk)));
+    const size_t threads = place.size();
+
+    // Sample and splitters.
+    unsigned levels = 1;
+    while (levels < 8 && (size_t(2) << levels) * kBucketTarget <= n) ++levels;
+    const size_t k = size_t(1) << levels;
+    size_t alpha = 1;
+    for (size_t m = n; m >= 32; m >>= 5) ++alpha;  // about log2(n) / 5
+    const size_t samples = alpha * k - 1;
+    Scratch<T> sample(ws, samples + 2 * k);
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ n;
+    for (size_t s = 0; s < samples; ++s) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sample[s] = a[state % n];
+    }
+    ops::moved(samples, sizeof(T));
+    pdq::sort(sample.data(), sample.data() + samples, cmp);
+
+    T* sorted = sample.data() + samples;
+    T* tree = sorted + k;
+    size_t distinct = 0;
+    bool equality = false;
+    for (size_t s = 1; s < k; ++s) {
+        const T& x = sample[s * alpha - 1];
+        if (distinct > 0 && !cmp(sorted[distinct - 1], x)) {
+            equality = true;
+            continue;
+        }
+        sorted[distinct++] = x;
+    }
+    for (size_t s = distinct; s + 1 < k; ++s) sorted[s] = sorted[distinct - 1];
+    size_t next = 0;
+    build_tree(tree, sorted, 1, k, next);
+    const Classifier<T> classifier{tree, sorted, k, levels, equality};
+    const size_t B = classifier.buckets();
+
+    // Classify: bucket ids and per-thread counts.
+    Scratch<Bucket> oracle(ws, n);
+    Scratch<size_t> hist(ws, threads * B);
+    std::fill_n(hist.data(), threads * B, 0);
+    ops::scratch(n * sizeof(Bucket) + threads * B * sizeof(size_t) + (samples + 2 * k) * sizeof(T));
+    const size_t stripe = (n + threads - 1) / threads;
+    numa::run_placed(place, pin, [&](size_t t) {
+        const size_t b = std::min(n, t * stripe), e = std::min(n, b + stripe);
+        classifier.classify(a + b, e - b, oracle.data() + b, cmp);
+        size_t* h = &hist[t * B];
+        for (size_t i = b; i < e; ++i) ++h[oracle[i]];
+    });
+
+    // Bucket ranges per node, in proportion to each node's threads.
+    const size_t nodeCount = numa::nodes().size();
+    std::vector<size_t> cnt(B, 0), start(B + 1, 0), share(nodeCount, 0), firstBucket(nodeCount + 1, B);
+    for (size_t t = 0; t < threads; ++t) {
+        ++share[place[t]];
+        for (size_t b = 0; b < B; ++b) cnt[b] += hist[t * B + b];
+    }
+    for (size_t b = 0; b < B; ++b) start[b + 1] = start[b] + cnt[b];
+    {
+        size_t b = 0, target = 0;
+        for (size_t node = 0; node < nodeCount; ++node) {
+            firstBucket[node] = b;
+            target += share[node];
+            while (b < B && start[b + 1] * threads <= n * target) ++b;
+        }
+        firstBucket[nodeCount] = B;
+    }
+    std::vector<size_t> nodeOf(B);
+    for (size_t node = 0; node < nodeCount; ++node) {
+        for (size_t b = firstBucket[node]; b < firstBucket[node + 1]; ++b) nodeOf[b] = node;
+    }
+
+    // Node buffers: the buckets, then as much room again for radix sort.
+    std::vector<T*> buffer(nodeCount, nullptr);
+    std::vector<SortWorkspace::Mark> marks(nodeCount);
+    for (size_t node = 0; node < nodeCount; ++node) {
+        const size_t m = start[firstBucket[node + 1]] - start[firstBucket[node]];
+        if (m == 0) continue;
+        const size_t bytes = (kRadix ? 2 : 1) * m * sizeof(T);
+        arenas.reserve(node, bytes + SortWorkspace::kAlign);
+        marks[node] = arenas[node].mark();
+        buffer[node] = static_cast<T*>(arenas[node].allocate(bytes));
+        ops::scratch(bytes);
+    }
+    auto local = [&](size_t b) { return buffer[nodeOf[b]] + (start[b] - start[firstBucket[nodeOf[b]]]); };
+
+    // Scatter each stripe to its buckets, thread by thread within a bucket.
+    Scratch<T*> out(ws, threads * B);
+    for (size_t b = 0; b < B; ++b) {
+        T* p = cnt[b] ? local(b) : nullptr;
+        for (size_t t = 0; t < threads; ++t) {
+            out[t * B + b] = p;
+            p += hist[t * B + b];
+        }
+    }
+    numa::run_placed(place, pin, [&](size_t t) {
+        const size_t b = std::min(n, t * stripe), e = std::min(n, b + stripe);
+        T** o = &out[t * B];
+        for (size_t i = b; i < e; ++i) *o[oracle[i]]++ = a[i];
+    });
+    ops::moved(n, sizeof(T));
+
+    // Each node's threads take its buckets, largest first.
+    std::vector<size_t> order(B);
+    for (size_t b = 0; b < B; ++b) order[b] = b;
+    for (size_t node = 0; node < nodeCount; ++node) {
+        std::sort(order.begin() + firstBucket[node], order.begin() + firstBucket[node + 1],
+                  [&](size_t x, size_t y) { return cnt[x] > cnt[y]; });
+    }
+    std::vector<std::atomic<size_t>> taken(nodeCount);
+    for (size_t node = 0; node < nodeCount; ++node) taken[node] = firstBucket[node];
+    numa::run_placed(place, pin, [&](size_t t) {
+        const size_t node = place[t];
+        for (size_t i = taken[node]++; i < firstBucket[node + 1]; i = taken[node]++) {
+            const size_t b = order[i];
+            if (cnt[b] == 0) continue;
+            T* p = local(b);
+            if (!equality || b % 2 == 0) {
+                const size_t m = start[firstBucket[node + 1]] - start[firstBucket[node]];
+                sort_sequential<T, Compare>(p, p + m, cnt[b], cmp);
+            }
+            std::memcpy(static_cast<void*>(a + start[b]), p, cnt[b] * sizeof(T));
+        }
+    });
+    ops::moved(n, sizeof(T));
+
+    for (size_t node = 0; node < nodeCount; ++node) {
+        if (buffer[node]) arenas[node].release(marks[node]);
+    }
+}
+
+}
+
+// threads == 0 uses every CPU; node >= 0 keeps all threads on that NUMA
+// node (an index into numa::nodes()) to measure one socket. Threads are
+// pinned to their nodes only when that changes anything, i.e. on a
+// multi-node machine.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class SampleSorter final : public Sorter<T, Compare> {
+public:
+    explicit SampleSorter(unsigned threads = 0, int node = -1, Compare cmp = Compare())
+        : Sorter<T, Compare>(cmp), node_(node), place_(numa::place_threads(threads, node)) {}
+
+    std::string name() const override {
+        return node_ < 0 ? "SampleSort" : "SampleSort(node" + std::to_string(numa::nodes()[place_[0]].id) + ")";
+    }
+    unsigned threads() const { return static_cast<unsigned>(place_.size()); }
+    bool parallel() const override { return threads() > 1; }
+
+    void sort(std::vector<T>& a) override {
+        sample::sort<T, Compare>(a.data(), a.size(), this->cmp_, place_, numa::nodes().size() > 1, arenas_,
+                                 this->workspace_);
+    }
+
+private:
+    int node_;
+    std::vector<size_t> place_;
+    numa::NodeArenas arenas_;
+};
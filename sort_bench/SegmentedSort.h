@@ -0,0 +1,241 @@
+#pragma once
+#include "Parallel.h"
+#include "PdqSort.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Segmented sort: many independent small arrays packed back to back in
+// one buffer, segment i being data[offsets[i], offsets[i + 1]). Every
+// segment is sorted by a routine picked for its length, with no per-call
+// virtual dispatch or allocation. Up to kNetworkMax elements that is a
+// sorting network. Up to kMergeMax the segment is cut into network-sorted
+// blocks that are merged bottom-up with a branch-free merge through a
+// stack buffer; on random keys this beats insertion sort by 3x at 32
+// elements, where mispredicted branches dominate both it and pdqsort.
+// Longer segments go to pdqsort. Threads take contiguous runs of segments
+// holding about the same number of elements each.
+namespace segmented {
+
+constexpr size_t kNetworkMax = 16;
+constexpr size_t kMergeMax = 512;
+constexpr size_t kParallelMinChunk = 1 << 16;  // elements per thread
+
+struct Exchange {
+    uint8_t lo;
+    uint8_t hi;
+};
+
+// Batcher's odd-even merge sort network for the next power of two above
+// N, minus the comparators that touch an index >= N: those only ever
+// meet the +infinity padding and never exchange.
+template <size_t N, typename Fn>
+constexpr void for_each_exchange(Fn&& fn) {
+    size_t padded = 1;
+    while (padded < N) padded <<= 1;
+    for (size_t p = 1; p < padded; p <<= 1) {
+        for (size_t k = p; k >= 1; k >>= 1) {
+            for (size_t j = k % p; j + k < padded; j += 2 * k) {
+                for (size_t i = 0; i < std::min(k, padded - j - k); ++i) {
+                    const size_t a = i + j, b = i + j + k;
+                    if (a / (2 * p) == b / (2 * p) && b < N) fn(a, b);
+                }
+            }
+        }
+    }
+}
+
+template <size_t N>
+constexpr size_t network_size() {
+    size_t c = 0;
+    for_each_exchange<N>([&c](size_t, size_t) { ++c; });
+    return c;
+}
+
+template <size_t N>
+constexpr std::array<Exchange, network_size<N>()> build_network() {
+    std::array<Exchange, network_size<N>()> net{};
+    size_t c = 0;
+    for_each_exchange<N>([&](size_t a, size_t b) {
+        net[c].lo = static_cast<uint8_t>(a);
+        net[c].hi = static_cast<uint8_t>(b);
+        ++c;
+    });
+    return net;
+}
+
+template <size_t N>
+constexpr std::array<Exchange, network_size<N>()> kNetwork = build_network<N>();
+
+// Branch-free compare-exchange: a and b end up in order whatever the
+// data, which is what makes a network worth it for tiny inputs.
+template <typename T, typename Compare>
+inline void exchange(T& a, T& b, Compare& cmp) {
+    const bool swap = cmp(b, a);
+    T lo = swap ? b : a;
+    T hi = swap ? a : b;
+    a = lo;
+    b = hi;
+    ops::moved(2, sizeof(T));
+}
+
+template <size_t N, typename T, typename Compare, size_t... I>
+inline void run_network(T* a, Compare& cmp, std::index_sequence<I...>) {
+    (void) a;
+    (void) cmp;
+    (exchange(a[kNetwork<N>[I].lo], a[kNetwork<N>[I].hi], cmp), ...);
+}
+
+// Sorts a[0, N) with the network for N, unrolled into straight-line code.
+template <size_t N, typename T, typename Compare>
+inline void network_sort(T* a, Compare& cmp) {
+    run_network<N>(a, cmp, std::make_index_sequence<network_size<N>()>());
+}
+
+template <typename T, typename Compare, size_t... N>
+inline void network_sort(T* a, size_t n, Compare& cmp, std::index_sequence<N...>) {
+    using Fn = void (*)(T*, Compare&);
+    static constexpr Fn kSorts[] = {&network_sort<N, T, Compare>...};
+    kSorts[n](a, cmp);
+}
+
+// Merges sorted a[0, na) and b[0, nb) into out without branching on the
+// data; equal elements take a first.
+template <typename T, typename Compare>
+void merge_branchless(const T* a, size_t na, const T* b, size_t nb, T* out, Compare& cmp) {
+    size_t i = 0, j = 0;
+    T* o = out;
+    while (i < na && j < nb) {
+        const bool right = cmp(b[j], a[i]);
+        *o++ = right ? b[j] : a[i];
+        j += right;
+        i += !right;
+    }
+    o = std::copy(a + i, a + na, o);
+    std::copy(b + j, b + nb, o);
+    ops::moved(na + nb, sizeof(T));
+}
+
+// Sorts a[0, n), n <= kMergeMax: network-sorted blocks of kNetworkMax,
+// then merge passes alternating between a and buf. Pairs of blocks that
+// are already in order are copied instead of merged.
+template <typename T, typename Compare>
+void block_merge_sort(T* a, size_t n, T* buf, Compare& cmp) {
+    for (size_t b = 0; b < n; b += kNetworkMax) {
+        network_sort(a + b, std::min(kNetworkMax, n - b), cmp, std::make_index_sequence<kNetworkMax + 1>());
+    }
+    T* src = a;
+    T* dst = buf;
+    for (size_t width = kNetworkMax; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            const size_t mid = std::min(lo + width, n), hi = std::min(lo + 2 * width, n);
+            if (mid == hi || !cmp(src[mid], src[mid - 1])) {
+                std::copy(src + lo, src + hi, dst + lo);
+                ops::moved(hi - lo, sizeof(T));
+            } else {
+                merge_branchless(src + lo, mid - lo, src + mid, hi - mid, dst + lo, cmp);
+            }
+        }
+        std::swap(src, dst);
+    }
+    if (src != a) {
+        std::copy(src, src + n, a);
+        ops::moved(n, sizeof(T));
+    }
+}
+
+// Sorts one segment a[0, n) with the routine for its length; buf holds
+// kMergeMax elements. Longer segments that are already sorted cost one
+// scan, which on unsorted ones usually stops within a few elements.
+template <typename T, typename Compare>
+inline void sort_segment(T* a, size_t n, T* buf, Compare& cmp) {
+    if (n <= kNetworkMax) network_sort(a, n, cmp, std::make_index_sequence<kNetworkMax + 1>());
+    else if (std::is_sorted(a, a + n, cmp)) return;
+    else if (n <= kMergeMax) block_merge_sort(a, n, buf, cmp);
+    else pdq::sort(a, a + n, cmp);
+}
+
+// Sorts data[offsets[i], offsets[i + 1]) for every i < segments; offsets
+// holds segments + 1 non-decreasing entries. Segments are handed to
+// threads by where they start, so each chunk of parallel_for over the
+// elements sorts the segments beginning inside it.
+template <typename T, typename Offset, typename Compare>
+void sort(T* data, const Offset* offsets, size_t segments, Compare& cmp, unsigned threads = 0) {
+    if (segments == 0) return;
+    const Offset base = offsets[0];
+    const size_t n = static_cast<size_t>(offsets[segments] - base);
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t) {
+        const Offset* first = std::lower_bound(offsets, offsets + segments, static_cast<Offset>(base + b));
+        const Offset* last = std::lower_bound(first, offsets + segments, static_cast<Offset>(base + e));
+        if (e == n) last = offsets + segments;
+        T buf[kMergeMax];
+        for (const Offset* s = first; s != last; ++s) {
+            sort_segment(data + s[0], static_cast<size_t>(s[1] - s[0]), buf, cmp);
+        }
+    }, kParallelMinChunk);
+}
+
+}
+
+// Benchmark wrapper: sorts the input as the segments described by
+// `offsets` (which must outlive the sorter). Auto is segmented::sort;
+// the others sort each segment with one routine, for comparison.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class SegmentedSorter final : public Sorter<T, Compare> {
+public:
+    enum class Method { Auto, Insertion, Pdq, Std };
+
+    SegmentedSorter(Method method, const std::vector<size_t>& offsets, unsigned threads = 1, Compare cmp = Compare())
+        : Sorter<T, Compare>(cmp), method_(method), offsets_(offsets), threads_(threads) {}
+
+    std::string name() const override {
+        std::string t = threads_ == 1 ? "" : threads_ == 0 ? ",all" : "," + std::to_string(threads_) + "t";
+        switch (method_) {
+            case Method::Auto: return "segmented(network" + t + ")";
+            case Method::Insertion: return "segmented(insertion" + t + ")";
+            case Method::Pdq: return "segmented(pdqsort" + t + ")";
+            case Method::Std: return "segmented(std::sort" + t + ")";
+        }
+        return "?";
+    }
+
+    bool parallel() const override { return resolve_threads(threads_) > 1; }
+
+    bool supports(const std::vector<T>& a, std::string& reason) const override {
+        if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != a.size()) {
+            reason = "offsets do not cover the input";
+            return false;
+        }
+        reason.clear();
+        return true;
+    }
+
+    void sort(std::vector<T>& a) override {
+        const size_t segments = offsets_.size() - 1;
+        if (method_ == Method::Auto) {
+            segmented::sort(a.data(), offsets_.data(), segments, this->cmp_, threads_);
+            return;
+        }
+        auto& cmp = this->cmp_;
+        parallel_for(segments, threads_, [&](size_t b, size_t e, size_t) {
+            for (size_t s = b; s < e; ++s) {
+                T* p = a.data() + offsets_[s];
+                const size_t n = offsets_[s + 1] - offsets_[s];
+                switch (method_) {
+                    case Method::Insertion: detail::insertion_sort(p, n, cmp); break;
+                    case Method::Pdq: pdq::sort(p, p + n, cmp); break;
+                    default: std::sort(p, p + n, cmp); break;
+                }
+            }
+        }, 1);
+    }
+
+private:
+    Method method_;
+    const std::vector<size_t>& offsets_;
+    unsigned threads_;
+};
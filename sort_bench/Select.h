@@ -0,0 +1,305 @@
+#pragma once
+#include "PdqSort.h"
+#include "SimdSort.h"
+#include "SortAlgorithms.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// Selection: the k smallest elements or the k-th one, without paying for
+// a full sort. nth_element is Floyd-Rivest SELECT with an introselect
+// style depth budget, partial_sort a bounded heap, and TopK a streaming
+// selector whose memory does not grow with the input.
+namespace selection {
+
+constexpr size_t kInsertionMax = 16;
+constexpr ptrdiff_t kSampleMin = 600;  // ranges above this pick their pivot from a sample
+
+// Replaces the root of the max-heap heap[0, k) with x and restores the
+// heap property.
+template <typename T, typename Compare>
+void replace_top(T* heap, size_t k, T x, Compare& cmp) {
+    size_t hole = 0;
+    for (;;) {
+        size_t child = 2 * hole + 1;
+        if (child >= k) break;
+        if (child + 1 < k && cmp(heap[child], heap[child + 1])) ++child;
+        if (!cmp(x, heap[child])) break;
+        heap[hole] = ops::move(heap[child]);
+        hole = child;
+    }
+    heap[hole] = ops::move(x);
+}
+
+// Moves the k smallest elements of a[0, n) into a[0, k), arranged as a
+// max-heap under cmp, so a[0] is the k-th smallest.
+template <typename T, typename Compare>
+void heap_select(T* a, size_t n, size_t k, Compare& cmp) {
+    if (k == 0) return;
+    std::make_heap(a, a + k, cmp);
+    for (size_t i = k; i < n; ++i) {
+        if (cmp(a[i], a[0])) {
+            T x = ops::move(a[i]);
+            a[i] = ops::move(a[0]);
+            replace_top(a, k, ops::move(x), cmp);
+        }
+    }
+}
+
+// The k smallest elements of a[0, n) in order in a[0, k); the rest are
+// left in a[k, n) in no particular order. HeapSorter's algorithm on a
+// heap of k elements: O(n log k).
+template <typename T, typename Compare>
+void partial_sort(T* a, size_t n, size_t k, Compare& cmp) {
+    k = std::min(k, n);
+    heap_select(a, n, k, cmp);
+    std::sort_heap(a, a + k, cmp);
+}
+
+// Floyd-Rivest SELECT on a[left, right] (inclusive). Large ranges first
+// select k within a sample around it, so the pivot is close to the k-th
+// element and one partition discards most of the range; about n + min(k,
+// n - k) comparisons on random input. Each round spends one unit of
+// depth, and when it runs out the remaining range falls back to
+// heap_select, which bounds the worst case at O(n log n).
+template <typename T, typename Compare>
+void select_range(T* a, ptrdiff_t left, ptrdiff_t right, ptrdiff_t k, Compare& cmp, int depth) {
+    while (right > left) {
+        if (right - left < static_cast<ptrdiff_t>(kInsertionMax)) {
+            detail::insertion_sort(a + left, static_cast<size_t>(right - left + 1), cmp);
+            return;
+        }
+        if (depth-- == 0) {
+            T* base = a + left;
+            const size_t m = static_cast<size_t>(k - left + 1);
+            heap_select(base, static_cast<size_t>(right - left + 1), m, cmp);
+            std::pop_heap(base, base + m, cmp);
+            return;
+        }
+
+        if (right - left > kSampleMin) {
+            const double n = static_cast<double>(right - left + 1);
+            const double i = static_cast<double>(k - left + 1);
+            const double z = std::log(n);
+            const double s = 0.5 * std::exp(2.0 * z / 3.0);
+            const double sd = 0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1.0 : 1.0);
+            const ptrdiff_t sampleLeft = std::max(left, static_cast<ptrdiff_t>(static_cast<double>(k) - i * s / n + sd));
+            const ptrdiff_t sampleRight =
+                std::min(right, static_cast<ptrdiff_t>(static_cast<double>(k) + (n - i) * s / n + sd));
+            select_range(a, sampleLeft, sampleRight, k, cmp, depth);
+        } else {
+            // Median of three moved to k, so sorted input does not degrade.
+            const ptrdiff_t mid = left + (right - left) / 2;
+            if (cmp(a[mid], a[left])) ops::swap(a[mid], a[left]);
+            if (cmp(a[right], a[mid])) {
+                ops::swap(a[right], a[mid]);
+                if (cmp(a[mid], a[left])) ops::swap(a[mid], a[left]);
+            }
+            ops::swap(a[mid], a[k]);
+        }
+
+        // Hoare partition around t = a[k], with t parked at one end as the
+        // sentinel for both scans.
+        const T t = a[k];
+        ptrdiff_t i = left, j = right;
+        ops::swap(a[left], a[k]);
+        if (cmp(t, a[right])) ops::swap(a[right], a[left]);
+        while (i < j) {
+            ops::swap(a[i], a[j]);
+            ++i;
+            --j;
+            while (cmp(a[i], t)) ++i;
+            while (cmp(t, a[j])) --j;
+        }
+        if (!cmp(a[left], t) && !cmp(t, a[left])) {
+            ops::swap(a[left], a[j]);
+        } else {
+            ++j;
+            ops::swap(a[j], a[right]);
+        }
+        if (j <= k) left = j + 1;
+        if (k <= j) right = j - 1;
+    }
+}
+
+// Rearranges a[0, n) so that a[k] is the element a full sort would put
+// there, nothing before it is ordered after it and nothing after it is
+// ordered before it. k < n.
+template <typename T, typename Compare>
+void nth_element(T* a, size_t n, size_t k, Compare& cmp) {
+    if (k >= n) return;
+    int depth = 0;
+    for (size_t m = n; m >>= 1;) ++depth;
+    select_range(a, 0, static_cast<ptrdiff_t>(n) - 1, static_cast<ptrdiff_t>(k), cmp, 2 * depth);
+}
+
+// The k smallest in order in a[0, k): nth_element for the k-th, then a
+// pdqsort of the elements before it.
+template <typename T, typename Compare>
+void select_sort(T* a, size_t n, size_t k, Compare& cmp) {
+    k = std::min(k, n);
+    if (k == 0) return;
+    nth_element(a, n, k - 1, cmp);
+    pdq::sort(a, a + k - 1, cmp);
+}
+
+// int32/float keys in ascending order can go through simd_filter_less.
+template <typename T, typename Compare>
+struct simd_filterable
+    : std::integral_constant<bool, (std::is_same<T, int32_t>::value || std::is_same<T, float>::value) &&
+                                       std::is_same<Compare, ops::Counting<std::less<T>>>::value> {};
+
+// Streaming top-k: push() takes the input a chunk at a time and result()
+// gives the k smallest seen so far, in order. Candidates collect in a
+// buffer of k + max(k, kMinRoom) elements; once it has filled for the
+// first time, nth_element cuts it back to its k smallest and the largest
+// of those becomes the threshold. From then on only elements ordered
+// before the threshold are kept, a branch-free (or SIMD) filter over
+// each chunk, and every cut tightens the threshold, so on random input
+// almost nothing past the first few chunks survives the filter.
+template <typename T, typename Compare = ops::Counting<typename KeyTraits<T>::Compare>>
+class TopK {
+public:
+    static constexpr size_t kMinRoom = 4096;
+    static constexpr size_t kFilterSlack = 16;  // simd_filter_less may store past its output
+
+    explicit TopK(size_t k, bool simd = true, Compare cmp = Compare())
+        : k_(k), cap_(k + std::max(k, kMinRoom)), cmp_(cmp), simd_(simd), buf_(cap_ + kFilterSlack) {}
+
+    void push(const T* data, size_t n) {
+        if (k_ == 0) return;
+        while (n > 0) {
+            const size_t room = cap_ - size_;
+            const size_t take = std::min(n, room);
+            if (!haveThreshold_) {
+                std::copy(data, data + take, buf_.data() + size_);
+                ops::moved(take, sizeof(T));
+                size_ += take;
+            } else {
+                size_ += filter(data, take, buf_.data() + size_);
+            }
+            data += take;
+            n -= take;
+            // Keep at least half the room free, so filtered pieces stay large.
+            if (size_ == cap_ || (haveThreshold_ && cap_ - size_ < (cap_ - k_) / 2)) cut();
+        }
+    }
+
+    void push(const std::vector<T>& chunk) { push(chunk.data(), chunk.size()); }
+
+    // The min(k, elements pushed) smallest, in order. Pushing may go on.
+    std::vector<T> result() {
+        if (size_ > k_) cut();
+        std::vector<T> out(buf_.data(), buf_.data() + size_);
+        pdq::sort(out.data(), out.data() + out.size(), cmp_);
+        return out;
+    }
+
+    void clear() {
+        size_ = 0;
+        haveThreshold_ = false;
+    }
+
+    size_t k() const { return k_; }
+    bool simd() const { return simd_ && simd_filterable<T, Compare>::value; }
+
+private:
+    size_t filter(const T* src, size_t n, T* out) {
+        if constexpr (simd_filterable<T, Compare>::value) {
+            if (simd_) return simd_filter_less(src, n, threshold_, out);
+        }
+        ops::moved(n, sizeof(T));
+        size_t m = 0;
+        for (size_t i = 0; i < n; ++i) {
+            out[m] = src[i];
+            m += cmp_(src[i], threshold_);
+        }
+        return m;
+    }
+
+    void cut() {
+        nth_element(buf_.data(), size_, k_ - 1, cmp_);
+        size_ = k_;
+        threshold_ = buf_[k_ - 1];
+        haveThreshold_ = true;
+    }
+
+    size_t k_;
+    size_t cap_;
+    Compare cmp_;
+    bool simd_;
+    std::vector<T> buf_;
+    size_t size_{0};
+    bool haveThreshold_{false};
+    T threshold_{};
+};
+
+}
+
+// Benchmark wrapper: puts the k smallest elements in order at the front
+// of the input with one of the selection methods. The rest of the input
+// is left in an unspecified order.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class TopKSorter final : public Sorter<T, Compare> {
+public:
+    enum class Method { Heap, Select, StdPartial, StdNth, Stream, StreamSimd };
+
+    static constexpr size_t kStreamChunk = size_t(64) << 10;
+
+    TopKSorter(Method method, size_t k, Compare cmp = Compare()) : Sorter<T, Compare>(cmp), method_(method), k_(k) {}
+
+    std::string name() const override {
+        switch (method_) {
+            case Method::Heap: return "partial_sort(heap)";
+            case Method::Select: return "nth_element+sort";
+            case Method::StdPartial: return "std::partial_sort";
+            case Method::StdNth: return "std::nth_element+sort";
+            case Method::Stream: return "TopK(stream)";
+            case Method::StreamSimd: return std::string("TopK(stream,") + to_string(simd_level()) + ")";
+        }
+        return "?";
+    }
+
+    bool supports(const std::vector<T>& a, std::string& reason) const override {
+        (void) a;
+        if (method_ == Method::StreamSimd && !selection::simd_filterable<T, ops::Counting<Compare>>::value) {
+            reason = "SIMD filter needs int32/float keys";
+            return false;
+        }
+        reason.clear();
+        return true;
+    }
+
+    size_t prefix() const override { return k_; }
+
+    void sort(std::vector<T>& a) override {
+        const size_t n = a.size();
+        const size_t k = std::min(k_, n);
+        switch (method_) {
+            case Method::Heap: selection::partial_sort(a.data(), n, k, this->cmp_); break;
+            case Method::Select: selection::select_sort(a.data(), n, k, this->cmp_); break;
+            case Method::StdPartial: std::partial_sort(a.begin(), a.begin() + k, a.end(), this->cmp_); break;
+            case Method::StdNth:
+                if (k == 0) break;
+                std::nth_element(a.begin(), a.begin() + (k - 1), a.end(), this->cmp_);
+                std::sort(a.begin(), a.begin() + (k - 1), this->cmp_);
+                break;
+            case Method::Stream:
+            case Method::StreamSimd: {
+                selection::TopK<T, ops::Counting<Compare>> top(k, method_ == Method::StreamSimd, this->cmp_);
+                for (size_t i = 0; i < n; i += kStreamChunk) top.push(a.data() + i, std::min(kStreamChunk, n - i));
+                const std::vector<T> best = top.result();
+                std::copy(best.begin(), best.end(), a.begin());
+                break;
+            }
+        }
+    }
+
+private:
+    Method method_;
+    size_t k_;
+};
@@ -0,0 +1,540 @@
+#include "SimdSort.h"
+#include "PdqSort.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SORT_BENCH_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+SimdLevel detect_level() {
+    SimdLevel level = SimdLevel::Scalar;
+#if defined(SORT_BENCH_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) level = SimdLevel::Avx2;
+    if (level == SimdLevel::Avx2 && __builtin_cpu_supports("avx512f")) level = SimdLevel::Avx512;
+#endif
+    if (const char* cap = std::getenv("SORT_BENCH_SIMD")) {
+        if (std::strcmp(cap, "scalar") == 0) level = SimdLevel::Scalar;
+        else if (std::strcmp(cap, "avx2") == 0 && level == SimdLevel::Avx512) level = SimdLevel::Avx2;
+    }
+    return level;
+}
+
+int depth_limit(size_t n) {
+    int log = 0;
+    while (n >>= 1) ++log;
+    return 2 * log;
+}
+
+template <typename T>
+void scalar_sort(T* a, size_t n) {
+    ops::Counting<std::less<T>> lt;
+    pdq::sort(a, a + n, lt);
+}
+
+// Branch-free: every element is written and the output cursor only moves
+// past the kept ones.
+template <typename T>
+size_t scalar_filter_less(const T* src, size_t n, T threshold, T* out) {
+    ops::compared(n);
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[m] = src[i];
+        m += src[i] < threshold;
+    }
+    ops::moved(m, sizeof(T));
+    return m;
+}
+
+}
+
+SimdLevel simd_level() {
+    static const SimdLevel level = detect_level();
+    return level;
+}
+
+const char* to_string(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::Avx2:   return "avx2";
+        case SimdLevel::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+#if defined(SORT_BENCH_SIMD_X86)
+
+// Everything between here and the matching pop is compiled for AVX2 and
+// only reached after simd_level() has confirmed the CPU supports it.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,popcnt"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,popcnt")
+#endif
+
+namespace {
+
+constexpr size_t kSmallSort = 64;
+
+// permutevar8x32 indices that move the lanes selected by an 8-bit mask to
+// the front (in order) and the rest behind them: a compress-store that
+// AVX2 lacks.
+struct CompressTable {
+    alignas(32) int32_t idx[256][8];
+    CompressTable() {
+        for (int m = 0; m < 256; ++m) {
+            int k = 0;
+            for (int i = 0; i < 8; ++i) if (m & (1 << i)) idx[m][k++] = i;
+            for (int i = 0; i < 8; ++i) if (!(m & (1 << i))) idx[m][k++] = i;
+        }
+    }
+};
+
+const CompressTable& compress_table() {
+    static const CompressTable table;
+    return table;
+}
+
+inline __m256i lanes(int a, int b, int c, int d, int e, int f, int g, int h) {
+    return _mm256_setr_epi32(a, b, c, d, e, f, g, h);
+}
+
+struct I32x8 {
+    using T = int32_t;
+    using V = __m256i;
+
+    static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static V set1(T x) { return _mm256_set1_epi32(x); }
+    static V permute(V v, __m256i idx) { return _mm256_permutevar8x32_epi32(v, idx); }
+    static T pad() { return std::numeric_limits<T>::max(); }
+
+    static void minmax(V& a, V& b) {
+        V lo = _mm256_min_epi32(a, b);
+        b = _mm256_max_epi32(a, b);
+        a = lo;
+    }
+
+    // Compare-exchange of lane pairs given by `perm`; lanes in M keep the max.
+    template <int M>
+    static V cmpx(V v, __m256i perm) {
+        V p = permute(v, perm);
+        return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), M);
+    }
+
+    template <bool OrEqual>
+    static int mask(V v, V pivot) {
+        __m256i gt = OrEqual ? _mm256_cmpgt_epi32(v, pivot) : _mm256_cmpgt_epi32(pivot, v);
+        int m = _mm256_movemask_ps(_mm256_castsi256_ps(gt));
+        return OrEqual ? (~m & 0xFF) : m;
+    }
+};
+
+struct F32x8 {
+    using T = float;
+    using V = __m256;
+
+    static V load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(T x) { return _mm256_set1_ps(x); }
+    static V permute(V v, __m256i idx) { return _mm256_permutevar8x32_ps(v, idx); }
+    static T pad() { return std::numeric_limits<T>::infinity(); }
+
+    // Blend on one comparison mask rather than min_ps/max_ps, which would
+    // turn an equal (-0.0, +0.0) pair into two copies of the same value.
+    static void minmax(V& a, V& b) {
+        V swap = _mm256_cmp_ps(b, a, _CMP_LT_OQ);
+        V lo = _mm256_blendv_ps(a, b, swap);
+        b = _mm256_blendv_ps(b, a, swap);
+        a = lo;
+    }
+
+    template <int M>
+    static V cmpx(V v, __m256i perm) {
+        V p = permute(v, perm);
+        V swapLow = _mm256_cmp_ps(p, v, _CMP_LT_OQ);
+        V swapHigh = _mm256_cmp_ps(v, p, _CMP_LT_OQ);
+        return _mm256_blendv_ps(v, p, _mm256_blend_ps(swapLow, swapHigh, M));
+    }
+
+    template <bool OrEqual>
+    static int mask(V v, V pivot) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(v, pivot, OrEqual ? _CMP_LE_OQ : _CMP_LT_OQ));
+    }
+};
+
+// Bitonic sorting network for one register, all comparators ascending.
+template <typename Tr>
+typename Tr::V sort8(typename Tr::V v) {
+    const __m256i swap1 = lanes(1, 0, 3, 2, 5, 4, 7, 6);
+    const __m256i flip4 = lanes(3, 2, 1, 0, 7, 6, 5, 4);
+    const __m256i flip8 = lanes(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i swap2 = lanes(2, 3, 0, 1, 6, 7, 4, 5);
+    v = Tr::template cmpx<0xAA>(v, swap1);
+    v = Tr::template cmpx<0xCC>(v, flip4);
+    v = Tr::template cmpx<0xAA>(v, swap1);
+    v = Tr::template cmpx<0xF0>(v, flip8);
+    v = Tr::template cmpx<0xCC>(v, swap2);
+    v = Tr::template cmpx<0xAA>(v, swap1);
+    return v;
+}
+
+// Half-cleaner stages at distances 4, 2, 1 inside a bitonic register.
+template <typename Tr>
+typename Tr::V clean8(typename Tr::V v) {
+    v = Tr::template cmpx<0xF0>(v, lanes(4, 5, 6, 7, 0, 1, 2, 3));
+    v = Tr::template cmpx<0xCC>(v, lanes(2, 3, 0, 1, 6, 7, 4, 5));
+    v = Tr::template cmpx<0xAA>(v, lanes(1, 0, 3, 2, 5, 4, 7, 6));
+    return v;
+}
+
+// Sorts up to 64 elements entirely in registers: pad to a power-of-two
+// number of vectors, sort each, then bitonic-merge runs of 1, 2, 4 vectors.
+template <typename Tr>
+void small_sort(typename Tr::T* a, size_t n) {
+    using T = typename Tr::T;
+    using V = typename Tr::V;
+    if (n < 2) return;
+
+    alignas(32) T buf[kSmallSort];
+    size_t vecs = 1;
+    while (vecs * 8 < n) vecs *= 2;
+    std::memcpy(buf, a, n * sizeof(T));
+    std::fill(buf + n, buf + vecs * 8, Tr::pad());
+
+    V v[kSmallSort / 8];
+    for (size_t i = 0; i < vecs; ++i) v[i] = sort8<Tr>(Tr::load(buf + 8 * i));
+
+    const __m256i reverse = lanes(7, 6, 5, 4, 3, 2, 1, 0);
+    for (size_t w = 1; w < vecs; w *= 2) {
+        for (size_t base = 0; base < vecs; base += 2 * w) {
+            // Reversing the second run makes the pair one bitonic sequence.
+            V* hi = v + base + w;
+            std::reverse(hi, hi + w);
+            for (size_t i = 0; i < w; ++i) hi[i] = Tr::permute(hi[i], reverse);
+
+            for (size_t step = w; step >= 1; step /= 2) {
+                for (size_t blk = base; blk < base + 2 * w; blk += 2 * step) {
+                    for (size_t i = blk; i < blk + step; ++i) Tr::minmax(v[i], v[i + step]);
+                }
+            }
+            for (size_t i = base; i < base + 2 * w; ++i) v[i] = clean8<Tr>(v[i]);
+        }
+    }
+
+    for (size_t i = 0; i < vecs; ++i) Tr::store(buf + 8 * i, v[i]);
+    std::memcpy(a, buf, n * sizeof(T));
+
+    // In comparator lanes: 24 per sort8, then per merge level 4 per vector
+    // for each minmax step and 12 per clean8.
+    uint64_t lanesCompared = 24 * vecs;
+    for (size_t w = 1, steps = 1; w < vecs; w *= 2, ++steps) lanesCompared += vecs * (4 * steps + 12);
+    ops::compared(lanesCompared);
+    ops::moved(2 * n, sizeof(typename Tr::T));
+}
+
+// Puts the elements that compare to pivot (< or <=) into a remainder
+// buffer walk: used for the tail and the two saved edge vectors.
+template <bool OrEqual, typename T>
+void scalar_distribute(T* a, const T* src, size_t n, T pivot, size_t& writeLeft, size_t& writeRight) {
+    ops::compared(n);
+    ops::moved(n, sizeof(T));
+    for (size_t i = 0; i < n; ++i) {
+        bool left = OrEqual ? !(pivot < src[i]) : src[i] < pivot;
+        if (left) a[writeLeft++] = src[i];
+        else a[--writeRight] = src[i];
+    }
+}
+
+// In-place vectorized partition of a[0, n), n >= 16. The first and last
+// vectors are set aside so each side starts with 8 free slots; reading
+// from the side with less free space keeps at least 8 free on both sides,
+// so both full-width stores are always safe. Returns the size of the left part.
+template <bool OrEqual, typename Tr>
+size_t partition_avx2(typename Tr::T* a, size_t n, typename Tr::T pivot) {
+    using T = typename Tr::T;
+    using V = typename Tr::V;
+    const auto& table = compress_table();
+    const V vp = Tr::set1(pivot);
+
+    T edges[16];
+    std::memcpy(edges, a, 8 * sizeof(T));
+    std::memcpy(edges + 8, a + n - 8, 8 * sizeof(T));
+    ops::moved(16, sizeof(typename Tr::T));
+
+    size_t readLeft = 8, readRight = n - 8;
+    size_t writeLeft = 0, writeRight = n;
+
+    while (readRight - readLeft >= 8) {
+        V v;
+        if (readLeft - writeLeft <= writeRight - readRight) {
+            v = Tr::load(a + readLeft);
+            readLeft += 8;
+        } else {
+            readRight -= 8;
+            v = Tr::load(a + readRight);
+        }
+        int m = Tr::template mask<OrEqual>(v, vp);
+        int cnt = __builtin_popcount(static_cast<unsigned>(m));
+        V packed = Tr::permute(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[m])));
+        Tr::store(a + writeLeft, packed);
+        Tr::store(a + writeRight - 8, packed);
+        writeLeft += cnt;
+        writeRight -= 8 - cnt;
+        ops::compared(8);
+        ops::moved(8, sizeof(typename Tr::T));
+    }
+
+    T tail[8];
+    size_t tailN = readRight - readLeft;
+    std::memcpy(tail, a + readLeft, tailN * sizeof(T));
+    ops::moved(tailN, sizeof(typename Tr::T));
+    scalar_distribute<OrEqual>(a, tail, tailN, pivot, writeLeft, writeRight);
+    scalar_distribute<OrEqual>(a, edges, 16, pivot, writeLeft, writeRight);
+    return writeLeft;
+}
+
+template <typename T>
+T median3(T x, T y, T z) {
+    ops::compared(4);
+    return std::max(std::min(x, y), std::min(std::max(x, y), z));
+}
+
+template <typename T>
+T choose_pivot(const T* a, size_t n) {
+    if (n < 1024) return median3(a[0], a[n / 2], a[n - 1]);
+    size_t s = n / 8;
+    return median3(median3(a[0], a[s], a[2 * s]),
+                   median3(a[3 * s], a[4 * s], a[5 * s]),
+                   median3(a[6 * s], a[7 * s], a[n - 1]));
+}
+
+// Quicksort driver shared by both ISA levels; Part supplies the partition.
+// If the pivot is the minimum, elements equal to it are split off with a
+// <= partition, which guarantees progress on duplicate-heavy input.
+template <typename Part, typename T>
+void simd_quicksort(T* a, size_t n, int depth) {
+    while (n > kSmallSort) {
+        if (depth-- == 0) {
+            scalar_sort(a, n);
+            return;
+        }
+        T pivot = choose_pivot(a, n);
+        size_t k = Part::template partition<false>(a, n, pivot);
+        if (k == 0) {
+            k = Part::template partition<true>(a, n, pivot);
+            a += k;
+            n -= k;
+            continue;
+        }
+        if (k < n - k) {
+            simd_quicksort<Part>(a, k, depth);
+            a += k;
+            n -= k;
+        } else {
+            simd_quicksort<Part>(a + k, n - k, depth);
+            n = k;
+        }
+    }
+    Part::small_sort(a, n);
+}
+
+// Compress-store of the lanes below threshold through the permute table,
+// eight elements per step.
+template <typename Tr>
+size_t filter_less_avx2(const typename Tr::T* src, size_t n, typename Tr::T threshold, typename Tr::T* out) {
+    using V = typename Tr::V;
+    const auto& table = compress_table();
+    const V vt = Tr::set1(threshold);
+    size_t m = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        V v = Tr::load(src + i);
+        int mask = Tr::template mask<false>(v, vt);
+        Tr::store(out + m, Tr::permute(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[mask]))));
+        m += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+    }
+    ops::compared(i);
+    ops::moved(m, sizeof(typename Tr::T));
+    return m + scalar_filter_less(src + i, n - i, threshold, out + m);
+}
+
+template <typename Tr>
+struct Avx2Part {
+    template <bool OrEqual>
+    static size_t partition(typename Tr::T* a, size_t n, typename Tr::T pivot) {
+        return partition_avx2<OrEqual, Tr>(a, n, pivot);
+    }
+    static void small_sort(typename Tr::T* a, size_t n) { ::small_sort<Tr>(a, n); }
+};
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,popcnt"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,popcnt")
+#endif
+
+namespace {
+
+struct I32x16 {
+    using T = int32_t;
+    using V = __m512i;
+    static V load(const T* p) { return _mm512_loadu_si512(p); }
+    static V set1(T x) { return _mm512_set1_epi32(x); }
+    template <bool OrEqual>
+    static __mmask16 mask(V v, V pivot) {
+        return OrEqual ? _mm512_cmple_epi32_mask(v, pivot) : _mm512_cmplt_epi32_mask(v, pivot);
+    }
+    static void compress(T* p, __mmask16 m, V v) { _mm512_mask_compressstoreu_epi32(p, m, v); }
+};
+
+struct F32x16 {
+    using T = float;
+    using V = __m512;
+    static V load(const T* p) { return _mm512_loadu_ps(p); }
+    static V set1(T x) { return _mm512_set1_ps(x); }
+    template <bool OrEqual>
+    static __mmask16 mask(V v, V pivot) {
+        return _mm512_cmp_ps_mask(v, pivot, OrEqual ? _CMP_LE_OQ : _CMP_LT_OQ);
+    }
+    static void compress(T* p, __mmask16 m, V v) { _mm512_mask_compressstoreu_ps(p, m, v); }
+};
+
+// Same in-place scheme as partition_avx2 with 16 lanes and the native
+// compress-store, which writes only the selected lanes on each side.
+template <bool OrEqual, typename Tr>
+size_t partition_avx512(typename Tr::T* a, size_t n, typename Tr::T pivot) {
+    using T = typename Tr::T;
+    using V = typename Tr::V;
+    const V vp = Tr::set1(pivot);
+
+    T edges[32];
+    std::memcpy(edges, a, 16 * sizeof(T));
+    std::memcpy(edges + 16, a + n - 16, 16 * sizeof(T));
+    ops::moved(32, sizeof(typename Tr::T));
+
+    size_t readLeft = 16, readRight = n - 16;
+    size_t writeLeft = 0, writeRight = n;
+
+    while (readRight - readLeft >= 16) {
+        V v;
+        if (readLeft - writeLeft <= writeRight - readRight) {
+            v = Tr::load(a + readLeft);
+            readLeft += 16;
+        } else {
+            readRight -= 16;
+            v = Tr::load(a + readRight);
+        }
+        __mmask16 m = Tr::template mask<OrEqual>(v, vp);
+        int cnt = __builtin_popcount(static_cast<unsigned>(m));
+        Tr::compress(a + writeLeft, m, v);
+        writeLeft += cnt;
+        writeRight -= 16 - cnt;
+        Tr::compress(a + writeRight, static_cast<__mmask16>(~m), v);
+        ops::compared(16);
+        ops::moved(16, sizeof(typename Tr::T));
+    }
+
+    T tail[16];
+    size_t tailN = readRight - readLeft;
+    std::memcpy(tail, a + readLeft, tailN * sizeof(T));
+    ops::moved(tailN, sizeof(typename Tr::T));
+    scalar_distribute<OrEqual>(a, tail, tailN, pivot, writeLeft, writeRight);
+    scalar_distribute<OrEqual>(a, edges, 32, pivot, writeLeft, writeRight);
+    return writeLeft;
+}
+
+template <typename Tr>
+size_t filter_less_avx512(const typename Tr::T* src, size_t n, typename Tr::T threshold, typename Tr::T* out) {
+    using V = typename Tr::V;
+    const V vt = Tr::set1(threshold);
+    size_t m = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        V v = Tr::load(src + i);
+        __mmask16 mask = Tr::template mask<false>(v, vt);
+        Tr::compress(out + m, mask, v);
+        m += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+    }
+    ops::compared(i);
+    ops::moved(m, sizeof(typename Tr::T));
+    return m + scalar_filter_less(src + i, n - i, threshold, out + m);
+}
+
+template <typename Tr, typename Small>
+struct Avx512Part {
+    template <bool OrEqual>
+    static size_t partition(typename Tr::T* a, size_t n, typename Tr::T pivot) {
+        return partition_avx512<OrEqual, Tr>(a, n, pivot);
+    }
+    static void small_sort(typename Tr::T* a, size_t n) { ::small_sort<Small>(a, n); }
+};
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+void simd_sort(int32_t* a, size_t n) {
+#if defined(SORT_BENCH_SIMD_X86)
+    switch (simd_level()) {
+        case SimdLevel::Avx512: simd_quicksort<Avx512Part<I32x16, I32x8>>(a, n, depth_limit(n)); return;
+        case SimdLevel::Avx2:   simd_quicksort<Avx2Part<I32x8>>(a, n, depth_limit(n)); return;
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    scalar_sort(a, n);
+}
+
+void simd_sort(float* a, size_t n) {
+#if defined(SORT_BENCH_SIMD_X86)
+    switch (simd_level()) {
+        case SimdLevel::Avx512: simd_quicksort<Avx512Part<F32x16, F32x8>>(a, n, depth_limit(n)); return;
+        case SimdLevel::Avx2:   simd_quicksort<Avx2Part<F32x8>>(a, n, depth_limit(n)); return;
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    scalar_sort(a, n);
+}
+
+size_t simd_filter_less(const int32_t* src, size_t n, int32_t threshold, int32_t* out) {
+#if defined(SORT_BENCH_SIMD_X86)
+    switch (simd_level()) {
+        case SimdLevel::Avx512: return filter_less_avx512<I32x16>(src, n, threshold, out);
+        case SimdLevel::Avx2:   return filter_less_avx2<I32x8>(src, n, threshold, out);
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    return scalar_filter_less(src, n, threshold, out);
+}
+
+size_t simd_filter_less(const float* src, size_t n, float threshold, float* out) {
+#if defined(SORT_BENCH_SIMD_X86)
+    switch (simd_level()) {
+        case SimdLevel::Avx512: return filter_less_avx512<F32x16>(src, n, threshold, out);
+        case SimdLevel::Avx2:   return filter_less_avx2<F32x8>(src, n, threshold, out);
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    return scalar_filter_less(src, n, threshold, out);
+}
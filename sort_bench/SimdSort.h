@@ -0,0 +1,52 @@
+#pragma once
+#include "Sorter.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+enum class SimdLevel { Scalar, Avx2, Avx512 };
+
+// Best level supported by the CPU, detected once. SORT_BENCH_SIMD=scalar|avx2
+// caps it, to exercise the fallbacks on newer machines.
+SimdLevel simd_level();
+const char* to_string(SimdLevel level);
+
+// Ascending in-place sorts. Float input must not contain NaN.
+void simd_sort(int32_t* a, size_t n);
+void simd_sort(float* a, size_t n);
+
+// Copies the elements of src[0, n) that are below threshold to out, in
+// input order, and returns how many there were. Full-width stores may
+// write up to 16 elements past the last one kept, so out needs room for
+// n + 16. NaN is never below the threshold.
+size_t simd_filter_less(const int32_t* src, size_t n, int32_t threshold, int32_t* out);
+size_t simd_filter_less(const float* src, size_t n, float threshold, float* out);
+
+// Vectorized quicksort for int32/float keys: AVX-512 or AVX2 compress-store
+// partitioning, in-register bitonic networks for blocks of up to 64
+// elements, and pdqsort on CPUs without AVX2.
+template <typename T>
+class SimdSorter final : public ISorterT<T> {
+    static_assert(std::is_same<T, int32_t>::value || std::is_same<T, float>::value,
+                  "SimdSorter supports int32 and float keys");
+
+public:
+    std::string name() const override { return std::string("SIMD(") + to_string(simd_level()) + ")"; }
+
+    bool supports(const std::vector<T>& a, std::string& reason) const override {
+        if (std::is_floating_point<T>::value) {
+            for (T x : a) {
+                if (std::isnan(static_cast<double>(x))) {
+                    reason = "SIMD sort does not order NaN.";
+                    return false;
+                }
+            }
+        }
+        reason.clear();
+        return true;
+    }
+
+    void sort(std::vector<T>& a) override { simd_sort(a.data(), a.size()); }
+};
@@ -1,79 +1,204 @@
 #pragma once
 #include "Sorter.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-class BubbleSorter final : public ISorter {
+namespace detail {
+
+template <typename T, typename Compare>
+void bubble_sort(T* a, size_t n, Compare& cmp) {
+    for (size_t i = 0; i < n; ++i) {
+        bool swapped = false;
+        for (size_t j = 1; j < n - i; ++j) {
+            if (cmp(a[j], a[j - 1])) {
+                ops::swap(a[j - 1], a[j]);
+                swapped = true;
+            }
+        }
+        if (!swapped) break;
+    }
+}
+
+template <typename T, typename Compare>
+void selection_sort(T* a, size_t n, Compare& cmp) {
+    for (size_t i = 0; i < n; ++i) {
+        size_t minIdx = i;
+        for (size_t j = i + 1; j < n; ++j) {
+            if (cmp(a[j], a[minIdx])) {
+                minIdx = j;
+            }
+        }
+        if (minIdx != i) ops::swap(a[i], a[minIdx]);
+    }
+}
+
+template <typename T, typename Compare>
+void insertion_sort(T* a, size_t n, Compare& cmp) {
+    for (size_t i = 1; i < n; ++i) {
+        T x = ops::move(a[i]);
+        size_t j = i;
+        while (j > 0 && cmp(x, a[j - 1])) {
+            a[j] = ops::move(a[j - 1]);
+            --j;
+        }
+        a[j] = ops::move(x);
+    }
+}
+
+template <typename T, typename Compare>
+void shell_sort(T* a, size_t n, Compare& cmp) {
+    // Ciura's gap sequence, extended by x2.25 for large inputs.
+    std::vector<size_t> gaps = {1, 4, 10, 23, 57, 132, 301, 701, 1750};
+    while (gaps.back() < n / 2) {
+        gaps.push_back(static_cast<size_t>(static_cast<double>(gaps.back()) * 2.25));
+    }
+
+    for (auto it = gaps.rbegin(); it != gaps.rend(); ++it) {
+        const size_t gap = *it;
+        for (size_t i = gap; i < n; ++i) {
+            T x = ops::move(a[i]);
+            size_t j = i;
+            while (j >= gap && cmp(x, a[j - gap])) {
+                a[j] = ops::move(a[j - gap]);
+                j -= gap;
+            }
+            a[j] = ops::move(x);
+        }
+    }
+}
+
+// Stable merge of a[0, na) and b[0, nb) into out; ties take from a.
+template <typename T, typename Compare>
+void merge_into(T* a, size_t na, T* b, size_t nb, T* out, Compare& cmp) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+
+    while (i < na && j < nb) {
+        out[k++] = cmp(b[j], a[i]) ? ops::move(b[j++]) : ops::move(a[i++]);
+    }
+    while (i < na) {
+        out[k++] = ops::move(a[i++]);
+    }
+    while (j < nb) {
+        out[k++] = ops::move(b[j++]);
+    }
+}
+
+// Insertion sort of src[0, n) written into dst, leaving src as scratch.
+template <typename T, typename Compare>
+void insertion_sort_into(T* src, T* dst, size_t n, Compare& cmp) {
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = i;
+        while (j > 0 && cmp(src[i], dst[j - 1])) {
+            dst[j] = ops::move(dst[j - 1]);
+            --j;
+        }
+        dst[j] = ops::move(src[i]);
+    }
+}
+
+constexpr size_t kMergeLeaf = 32;
+
+// Sorts a[0, n) into b if intoB, else in place in a, using the other
+// buffer as scratch. Each level sorts its halves into the opposite buffer
+// and merges back, so no level copies the range back.
+template <typename T, typename Compare>
+void merge_sort_impl(T* a, T* b, size_t n, bool intoB, Compare& cmp) {
+    if (n <= kMergeLeaf) {
+        if (intoB) insertion_sort_into(a, b, n, cmp);
+        else insertion_sort(a, n, cmp);
+        return;
+    }
+    size_t m = n / 2;
+    merge_sort_impl(a, b, m, !intoB, cmp);
+    merge_sort_impl(a + m, b + m, n - m, !intoB, cmp);
+
+    if (intoB) merge_into(a, m, a + m, n - m, b, cmp);
+    else merge_into(b, m, b + m, n - m, a, cmp);
+}
+
+}
+
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class BubbleSorter final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "Bubble"; }
-    void sort(std::vector<int>& a) override;
+    bool quadratic() const override { return true; }
+    void sort(std::vector<T>& a) override { detail::bubble_sort(a.data(), a.size(), this->cmp_); }
 };
 
-class SelectionSorter final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class SelectionSorter final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "Selection"; }
-    void sort(std::vector<int>& a) override;
+    bool quadratic() const override { return true; }
+    void sort(std::vector<T>& a) override { detail::selection_sort(a.data(), a.size(), this->cmp_); }
 };
 
-class InsertionSorter final :public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class InsertionSorter final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "Insertion"; }
-    void sort(std::vector<int>& a) override;
+    bool quadratic() const override { return true; }
+    void sort(std::vector<T>& a) override { detail::insertion_sort(a.data(), a.size(), this->cmp_); }
 };
 
-class QuickSorter final : public ISorter {
-public:
-    std::string name() const override { return "Quick"; }
-    void sort(std::vector<int>& a) override;
-};
-
-class MergeSorter final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class MergeSorter final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "Merge"; }
-    void sort(std::vector<int>& a) override;
+    void sort(std::vector<T>& a) override {
+        Scratch<T> tmp(this->workspace_, a.size());
+        ops::scratch(a.size() * sizeof(T));
+        detail::merge_sort_impl(a.data(), tmp.data(), a.size(), false, this->cmp_);
+    }
 };
 
-class HeapSorter final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class HeapSorter final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "Heap"; }
-    void sort(std::vector<int>& a) override;
+    void sort(std::vector<T>& a) override {
+        std::make_heap(a.begin(), a.end(), this->cmp_);
+        std::sort_heap(a.begin(), a.end(), this->cmp_);
+    }
 };
 
-class RadixSorterLSD256 final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class ShellSorter final : public Sorter<T, Compare> {
 public:
-    std::string name() const override { return "Radix"; }
-    bool support(const std::vector<int>& a, std::string& reason) const override;
-    void sort(std::vector<int&> a) override;
-};
-
-class CountingSorter final : public ISorter {
-public:
-    explicit CountingSorter(int maxValueInclusive) : maxValue_(maxValueInclusive) {}
-    std::string name() const override { return "Counting"; }
-    bool supports(const std::vector<int>& a, std::string& reason) const override;
-    void sort(std::vector<int>& a) override;
-
-private:
-    int maxValue_;
+    using Sorter<T, Compare>::Sorter;
+    std::string name() const override { return "Shell"; }
+    void sort(std::vector<T>& a) override { detail::shell_sort(a.data(), a.size(), this->cmp_); }
 };
 
-class StdSortIntrosort final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class StdSortIntrosort final : public Sorter<T, Compare> {
 public:
+    using Sorter<T, Compare>::Sorter;
     std::string name() const override { return "std::sort(Introsort)"; }
-    void sort(std::vector<int>& a) override;
-};
-
-
-class StdStableSort final : public ISorter {
-public:
-    std::string name() const override { return "std::stable_sort" }
-    void sort(std::vector<int>& a) override;
+    void sort(std::vector<T>& a) override { std::sort(a.begin(), a.end(), this->cmp_); }
 };
 
-class ShellSorter final : public ISorter {
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class StdStableSort final : public Sorter<T, Compare> {
 public:
-    std::string name() const override { return "Shell"; }
-    void sort(std::vector<int>& a) override;
+    using Sorter<T, Compare>::Sorter;
+    std::string name() const override { return "std::stable_sort"; }
+    void sort(std::vector<T>& a) override { std::stable_sort(a.begin(), a.end(), this->cmp_); }
 };
 
-std::vector<std::unique_ptr<ISorter>> make_default_sorters();
\ No newline at end of file
+// Defined for int32, int64, uint64, float, double and Record in SortAlgorithms.cpp.
+template <typename T>
+std::vector<std::unique_ptr<ISorterT<T>>> make_default_sorters();
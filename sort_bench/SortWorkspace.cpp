@@ -0,0 +1,148 @@
+#include "SortWorkspace.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static size_t round_up(size_t x, size_t to) { return (x + to - 1) / to * to; }
+
+const char* to_string(SortWorkspace::Backing b) {
+    switch (b) {
+        case SortWorkspace::Backing::Heap: return "heap";
+        case SortWorkspace::Backing::Pages: return "pages";
+        case SortWorkspace::Backing::TransparentHuge: return "thp";
+        case SortWorkspace::Backing::Huge: return "huge";
+    }
+    return "?";
+}
+
+SortWorkspace::~SortWorkspace() {
+    for (const Block& b : blocks_) free_block(b);
+}
+
+void* SortWorkspace::allocate(size_t bytes) {
+    bytes = round_up(std::max<size_t>(bytes, 1), kAlign);
+    if (current_ < blocks_.size() && used_ + bytes > blocks_[current_].size) {
+        // Blocks past the current one are free; take the first that fits.
+        size_t b = current_ + 1;
+        while (b < blocks_.size() && blocks_[b].size < bytes) ++b;
+        current_ = b;
+        used_ = 0;
+    }
+    if (current_ >= blocks_.size()) {
+        // Doubling keeps the number of blocks logarithmic in the final size.
+        blocks_.push_back(acquire(std::max({bytes, capacity(), kMinBlockBytes})));
+        current_ = blocks_.size() - 1;
+        used_ = 0;
+    }
+
+    void* p = blocks_[current_].data + used_;
+    used_ += bytes;
+    size_t inUse = used_;
+    for (size_t b = 0; b < current_; ++b) inUse += blocks_[b].size;
+    peak_ = std::max(peak_, inUse);
+    return p;
+}
+
+void SortWorkspace::release(Mark m) {
+    current_ = m.block;
+    used_ = m.used;
+    if (m.block == 0 && m.used == 0 && blocks_.size() > 1) rebuild(capacity());
+}
+
+void SortWorkspace::reserve(size_t bytes) {
+    // Blocks with scratch in use cannot move, so a busy workspace only grows.
+    if (current_ == 0 && used_ == 0) {
+        if (capacity() < bytes || blocks_.size() > 1) rebuild(std::max(bytes, capacity()));
+    } else if (capacity() < bytes) {
+        const Mark m = mark();
+        allocate(bytes);
+        release(m);
+    }
+    // Writing one byte per page is enough to fault it in.
+    for (const Block& b : blocks_) {
+        for (size_t off = 0; off < b.size; off += 4096) b.data[off] = 0;
+    }
+}
+
+void SortWorkspace::rebuild(size_t bytes) {
+    for (const Block& b : blocks_) free_block(b);
+    blocks_.clear();
+    blocks_.push_back(acquire(bytes));
+}
+
+size_t SortWorkspace::capacity() const {
+    size_t total = 0;
+    for (const Block& b : blocks_) total += b.size;
+    return total;
+}
+
+SortWorkspace::Backing SortWorkspace::backing() const {
+    const Block* largest = nullptr;
+    for (const Block& b : blocks_) {
+        if (!largest || b.size > largest->size) largest = &b;
+    }
+    return largest ? largest->backing : Backing::Heap;
+}
+
+SortWorkspace::Block SortWorkspace::acquire(size_t bytes) {
+    ++systemAllocations_;
+#if defined(__linux__)
+    if (bytes >= kHugePageBytes) {
+        const size_t size = round_up(bytes, kHugePageBytes);
+        if (hugePages_) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) return {static_cast<char*>(p), size, Backing::Huge};
+        }
+        // Transparent huge pages need a 2 MB aligned start, so over-map and trim.
+        const size_t span = size + (hugePages_ ? kHugePageBytes : 0);
+        void* p = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            char* base = static_cast<char*>(p);
+            char* start = base;
+            if (hugePages_) {
+                start = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(base), kHugePageBytes));
+                if (start > base) munmap(base, static_cast<size_t>(start - base));
+                if (base + span > start + size) munmap(start + size, static_cast<size_t>(base + span - (start + size)));
+            }
+            Backing backing = Backing::Pages;
+#ifdef MADV_HUGEPAGE
+            if (hugePages_ && madvise(start, size, MADV_HUGEPAGE) == 0) backing = Backing::TransparentHuge;
+#endif
+            return {start, size, backing};
+        }
+    }
+#elif defined(_WIN32)
+    if (bytes >= kHugePageBytes) {
+        const SIZE_T large = GetLargePageMinimum();
+        if (hugePages_ && large) {
+            const size_t size = round_up(bytes, large);
+            void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p) return {static_cast<char*>(p), size, Backing::Huge};
+        }
+        const size_t size = round_up(bytes, kHugePageBytes);
+        void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (p) return {static_cast<char*>(p), size, Backing::Pages};
+    }
+#endif
+    const size_t size = round_up(bytes, kAlign);
+    return {static_cast<char*>(::operator new(size, std::align_val_t(kAlign))), size, Backing::Heap};
+}
+
+void SortWorkspace::free_block(const Block& b) {
+    if (b.backing == Backing::Heap) {
+        ::operator delete(b.data, std::align_val_t(kAlign));
+        return;
+    }
+#if defined(__linux__)
+    munmap(b.data, b.size);
+#elif defined(_WIN32)
+    VirtualFree(b.data, 0, MEM_RELEASE);
+#endif
+}
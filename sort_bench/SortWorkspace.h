@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Reusable scratch arena for sorters. Memory is handed out stack-fashion
+// from a few large blocks and given back by rewinding to a mark, so a
+// warmed-up workspace serves every later sort of the same or smaller size
+// without a system allocation, page fault or zeroing pass. When a sort
+// outgrows the current block another one is chained on, and once all
+// scratch is released the blocks are merged into one of the combined size.
+//
+// Blocks of kHugePageBytes or more are backed by huge pages where the OS
+// allows: hugetlbfs pages, then transparent huge pages (madvise) on Linux,
+// and large pages on Windows when the process holds SeLockMemoryPrivilege.
+//
+// A workspace is not thread-safe; parallel sorters borrow from it on the
+// calling thread only.
+class SortWorkspace {
+public:
+    static constexpr size_t kAlign = 64;
+    static constexpr size_t kHugePageBytes = size_t(2) << 20;
+    static constexpr size_t kMinBlockBytes = size_t(64) << 10;
+
+    enum class Backing { Heap, Pages, TransparentHuge, Huge };
+
+    struct Mark {
+        size_t block{0};
+        size_t used{0};
+    };
+
+    explicit SortWorkspace(bool hugePages = true) : hugePages_(hugePages) {}
+    ~SortWorkspace();
+
+    SortWorkspace(const SortWorkspace&) = delete;
+    SortWorkspace& operator=(const SortWorkspace&) = delete;
+
+    // Uninitialised, kAlign-aligned room for `bytes`, valid until the
+    // workspace is rewound past this call.
+    void* allocate(size_t bytes);
+    Mark mark() const { return {current_, used_}; }
+    void release(Mark m);
+
+    // Grows the workspace to at least `bytes` up front and touches every
+    // page, so the first timed sort does not pay for the faults.
+    void reserve(size_t bytes);
+
+    size_t capacity() const;
+    size_t peak() const { return peak_; }
+    size_t systemAllocations() const { return systemAllocations_; }
+    // Backing of the largest block; Heap before the first allocation.
+    Backing backing() const;
+
+private:
+    struct Block {
+        char* data{nullptr};
+        size_t size{0};
+        Backing backing{Backing::Heap};
+    };
+
+    Block acquire(size_t bytes);
+    // Replaces all blocks with one of `bytes`; only valid with nothing in use.
+    void rebuild(size_t bytes);
+    static void free_block(const Block& b);
+
+    bool hugePages_;
+    std::vector<Block> blocks_;
+    size_t current_{0};  // block allocations come from
+    size_t used_{0};     // bytes in use in blocks_[current_]
+    size_t peak_{0};
+    size_t systemAllocations_{0};
+};
+
+const char* to_string(SortWorkspace::Backing b);
+
+// Scratch array of n elements for the duration of one call: borrowed from
+// `ws` and handed back on destruction, or heap-allocated when ws is null
+// (and for element types that need construction). Contents start
+// uninitialised. Instances must be destroyed in reverse order of creation,
+// which locals are.
+template <typename T>
+class Scratch {
+public:
+    Scratch(SortWorkspace* ws, size_t n) {
+        if constexpr (std::is_trivially_default_constructible<T>::value &&
+                      std::is_trivially_destructible<T>::value) {
+            if (ws) {
+                ws_ = ws;
+                mark_ = ws->mark();
+                data_ = static_cast<T*>(ws->allocate(n * sizeof(T)));
+                return;
+            }
+        }
+        owned_.reset(new T[n]);
+        data_ = owned_.get();
+    }
+
+    ~Scratch() {
+        if (ws_) ws_->release(mark_);
+    }
+
+    Scratch(const Scratch&) = delete;
+    Scratch& operator=(const Scratch&) = delete;
+
+    T* data() const { return data_; }
+    T& operator[](size_t i) const { return data_[i]; }
+
+private:
+    SortWorkspace* ws_{nullptr};
+    SortWorkspace::Mark mark_;
+    std::unique_ptr<T[]> owned_;
+    T* data_{nullptr};
+};
@@ -1,17 +1,76 @@
 #pragma once
+#include "KeyTypes.h"
+#include "OpCounts.h"
+#include "SortWorkspace.h"
 #include <string>
 #include <vector>
 
-class ISorter {
+template <typename T>
+class ISorterT {
 public:
-    virtual ~ISorter() = default;
+    using value_type = T;
+
+    virtual ~ISorterT() = default;
     virtual std::string name() const = 0;
-    virtual void sort(std::vector<int>& a) = 0;
+    virtual void sort(std::vector<T>& a) = 0;
 
-    virtual bool supports(const std::vector<int>& a, std::string& reason) const {
+    virtual bool supports(const std::vector<T>& a, std::string& reason) const {
         (void) a;
         reason.clear();
 
         return true;
     }
-};
\ No newline at end of file
+
+    // Every sorter is timed on a small prefix before its first large run,
+    // so the runner can skip it before it overruns
+    // BenchConfig::cellBudgetSec; O(n^2) sorters are extrapolated from it
+    // as n^2 rather than n log n.
+    virtual bool quadratic() const { return false; }
+
+    // Sorters that run on more than one thread. BenchConfig::pinCpu pins
+    // only the others: threads a parallel sorter starts inherit the
+    // caller's affinity, and one CPU would serialise them.
+    virtual bool parallel() const { return false; }
+
+    // Sorters whose worker threads outlive sort(), e.g. a thread pool.
+    // Hardware counters only pick up a thread's events when it exits, so
+    // the runner reports no counters for these rather than the caller's
+    // share alone.
+    virtual bool keepsThreads() const { return false; }
+
+    // Selection sorters only put the k smallest elements, in order, at the
+    // front and return k here; the runner then checks a[0, k) against a
+    // full sort and ignores the rest. 0 means the whole input is sorted.
+    virtual size_t prefix() const { return 0; }
+
+    // Detail about the last sort() for the report, e.g. which algorithm an
+    // adaptive sorter picked. Empty for most sorters.
+    virtual std::string note() const { return {}; }
+
+    // Sorters that need scratch memory borrow it from `ws` instead of
+    // allocating on every call; null (the default) allocates per call. The
+    // workspace must outlive its use and may be shared by sorters that run
+    // on the same thread.
+    void setWorkspace(SortWorkspace* ws) { workspace_ = ws; }
+    SortWorkspace* workspace() const { return workspace_; }
+
+protected:
+    SortWorkspace* workspace_{nullptr};
+};
+
+using ISorter = ISorterT<int>;
+
+// Base for concrete sorters. The comparator is a type parameter held by
+// value, so the algorithm templates inline it; the only virtual call is
+// the one sort() per benchmark run. It is wrapped in ops::Counting, which
+// counts its calls in SORT_BENCH_COUNT_OPS builds and is Compare otherwise.
+template <typename T, typename Compare = typename KeyTraits<T>::Compare>
+class Sorter : public ISorterT<T> {
+public:
+    using compare_type = Compare;
+
+    explicit Sorter(Compare cmp = Compare()) : cmp_(cmp) {}
+
+protected:
+    ops::Counting<Compare> cmp_;
+};
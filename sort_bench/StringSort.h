@@ -0,0 +1,365 @@
+#pragma once
+#include "Parallel.h"
+#include "SortAlgorithms.h"
+#include "SortWorkspace.h"
+#include "Strings.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Sorters for StringRef handles over one arena (see Strings.h). Comparison
+// sorts pay for every common prefix again on each comparison; these look
+// at each byte of a shared prefix about once per string.
+//
+// Multikey quicksort (Bentley & Sedgewick) partitions three ways on the
+// 8 bytes at the current depth, cached per string in an array beside the
+// handles so each level reads the arena once. The equal part moves 8 bytes
+// deeper, the other two stay at the same depth; small parts are insertion
+// sorted on the cached chunk.
+//
+// MSD radix sort distributes on one byte per level, with the strings that
+// have ended in bucket 0, and keeps the bucket of every string so the
+// scatter does not read the arena again. Levels where all strings share
+// the byte only count. Below kInsertionMax strings it switches to an
+// insertion sort that keeps the LCP of neighbours and starts every
+// comparison where the LCPs say the strings can differ.
+//
+// The parallel MSD sort runs the counting and scatter of each large level
+// on all threads, then hands the buckets, largest first, to threads that
+// finish them with the sequential MSD sort.
+namespace strsort {
+
+constexpr size_t kInsertionMax = 32;
+constexpr size_t kBuckets = 257;                // end of string, then bytes 0..255
+constexpr size_t kParallelMinChunk = 1 << 16;  // strings per thread
+
+inline const unsigned char* bytes(const char* arena, const StringRef& s) {
+    return reinterpret_cast<const unsigned char*>(arena + s.offset);
+}
+
+// Byte d of s plus one, or 0 past its end. The first 8 come from the prefix.
+inline unsigned char_at(const char* arena, const StringRef& s, size_t d) {
+    if (d >= s.length) return 0;
+    if (d < 8) return unsigned((s.prefix >> (56 - 8 * d)) & 0xFF) + 1;
+    return unsigned(bytes(arena, s)[d]) + 1;
+}
+
+// Bytes [d, d + 8) of s big-endian, zero-padded past its end.
+inline uint64_t chunk_at(const char* arena, const StringRef& s, size_t d) {
+    if (d == 0) return s.prefix;
+    if (d >= s.length) return 0;
+    return load_prefix(arena + s.offset + d, s.length - d);
+}
+
+// Sorts a[0, n), n <= kInsertionMax, whose strings share their first
+// `depth` bytes. lcp[i] holds the longest common prefix of a[i - 1] and
+// a[i] in the sorted part. Walking x left from the end, with h its LCP
+// with the element just right of it, a neighbour c whose LCP with that
+// element is below h is smaller than x, one above h is larger, and only
+// on a tie are bytes compared, starting at h.
+inline void lcp_insertion_sort(StringRef* a, size_t n, size_t depth, const char* arena) {
+    size_t lcp[kInsertionMax + 1];
+    for (size_t j = 1; j < n; ++j) {
+        const StringRef x = a[j];
+        const unsigned char* xs = bytes(arena, x);
+        size_t p = j, h = depth, left = depth;
+        while (p > 0) {
+            const StringRef c = a[p - 1];
+            const size_t lc = p < j ? lcp[p] : h;
+            if (lc < h) {
+                left = lc;
+                break;
+            }
+            if (lc == h) {
+                const unsigned char* cs = bytes(arena, c);
+                const size_t m = std::min(c.length, x.length);
+                size_t k = h;
+                while (k < m && cs[k] == xs[k]) ++k;
+                ops::compared(1);
+                if (k == c.length || (k < x.length && cs[k] < xs[k])) {
+                    left = k;
+                    break;
+                }
+                a[p] = c;
+                if (p < j) lcp[p + 1] = lc;
+                h = k;
+            } else {
+                a[p] = c;
+                lcp[p + 1] = lc;
+            }
+            ops::moved(1, sizeof(StringRef));
+            --p;
+        }
+        a[p] = x;
+        if (p > 0) lcp[p] = left;
+        if (p < j) lcp[p + 1] = h;
+    }
+}
+
+// Length of the prefix all of a[0, n) share with `ref`, given that it is
+// at least `depth`: one pass comparing each string with ref from there,
+// so a long shared prefix costs a sequential scan per string rather than
+// one counting pass per byte.
+inline size_t common_prefix(const StringRef* a, size_t n, const StringRef& ref, size_t depth, const char* arena) {
+    const unsigned char* first = bytes(arena, ref);
+    size_t lim = ref.length;
+    for (size_t i = 0; i < n && lim > depth; ++i) {
+        const unsigned char* s = bytes(arena, a[i]);
+        const size_t m = std::min<size_t>(lim, a[i].length);
+        size_t k = depth;
+        while (k < m && s[k] == first[k]) ++k;
+        lim = k;
+    }
+    return lim;
+}
+
+// Moves the strings of a[0, n) that end within the 8 bytes at `depth` to the
+// front and orders them by length; their 8 bytes at depth are equal, so
+// they are all prefixes of each other and of every string that goes on.
+// Returns how many there are.
+inline size_t split_ended(StringRef* a, size_t n, size_t depth) {
+    const size_t end = depth + 8;
+    StringRef* mid = std::partition(a, a + n, [end](const StringRef& s) { return s.length <= end; });
+    const size_t ended = static_cast<size_t>(mid - a);
+    std::sort(a, mid, [](const StringRef& x, const StringRef& y) { return x.length < y.length; });
+    ops::moved(n, sizeof(StringRef));
+    return ended;
+}
+
+// Insertion sort for multikey quicksort's small partitions: the cached
+// chunks decide unless equal, and only then are the bytes after them read.
+inline void chunk_insertion_sort(StringRef* a, uint64_t* cache, size_t n, size_t depth, const char* arena) {
+    const size_t next = depth + 8;
+    auto less = [&](uint64_t xc, const StringRef& x, uint64_t yc, const StringRef& y) {
+        ops::compared(1);
+        if (xc != yc) return xc < yc;
+        const size_t m = std::min(x.length, y.length);
+        if (m > next) {
+            const int c = std::memcmp(arena + x.offset + next, arena + y.offset + next, m - next);
+            if (c != 0) return c < 0;
+        }
+        return x.length < y.length;
+    };
+    for (size_t i = 1; i < n; ++i) {
+        const StringRef x = a[i];
+        const uint64_t xc = cache[i];
+        size_t j = i;
+        for (; j > 0 && less(xc, x, cache[j - 1], a[j - 1]); --j) {
+            a[j] = a[j - 1];
+            cache[j] = cache[j - 1];
+        }
+        a[j] = x;
+        cache[j] = xc;
+        ops::moved(i - j, sizeof(StringRef));
+    }
+}
+
+// a[0, n) share their first `depth` bytes, a multiple of 8, and cache[i]
+// holds chunk_at(a[i], depth).
+inline void multikey_quicksort(StringRef* a, uint64_t* cache, size_t n, size_t depth, const char* arena) {
+    while (n > kInsertionMax) {
+        uint64_t x = cache[0], y = cache[n / 2], z = cache[n - 1];
+        if (x > y) std::swap(x, y);
+        if (y > z) y = std::max(x, z);
+        const uint64_t pivot = y;
+
+        // Bentley-McIlroy: equal keys are parked at both ends during the
+        // scan and swapped into the middle afterwards.
+        ptrdiff_t pa = 0, pb = 0, pc = static_cast<ptrdiff_t>(n) - 1, pd = pc;
+        auto exchange = [&](ptrdiff_t i, ptrdiff_t j) {
+            std::swap(cache[i], cache[j]);
+            ops::swap(a[i], a[j]);
+        };
+        while (true) {
+            while (pb <= pc && !ops::less(pivot, cache[pb])) {
+                if (cache[pb] == pivot) exchange(pa++, pb);
+                ++pb;
+            }
+            while (pb <= pc && !ops::less(cache[pc], pivot)) {
+                if (cache[pc] == pivot) exchange(pc, pd--);
+                --pc;
+            }
+            if (pb > pc) break;
+            exchange(pb++, pc--);
+        }
+        const ptrdiff_t end = static_cast<ptrdiff_t>(n);
+        for (ptrdiff_t l = 0, r = pb - std::min(pa, pb - pa); l < std::min(pa, pb - pa); ++l, ++r) exchange(l, r);
+        for (ptrdiff_t l = pb, r = end - std::min(pd - pc, end - 1 - pd); r < end; ++l, ++r) exchange(l, r);
+        const size_t lt = static_cast<size_t>(pb - pa);
+        const size_t gt = n - static_cast<size_t>(pd - pc);
+
+        multikey_quicksort(a, cache, lt, depth, arena);
+        multikey_quicksort(a + gt, cache + gt, n - gt, depth, arena);
+
+        const bool whole = lt == 0 && gt == n;
+        const size_t ended = split_ended(a + lt, gt - lt, depth);
+        a += lt + ended;
+        cache += lt + ended;
+        n = gt - lt - ended;
+        depth += 8;
+        // Nothing split off: skip the rest of a shared prefix in one scan.
+        if (whole && n > 0) depth = common_prefix(a, n, a[0], depth, arena) / 8 * 8;
+        for (size_t k = 0; k < n; ++k) cache[k] = chunk_at(arena, a[k], depth);
+    }
+    chunk_insertion_sort(a, cache, n, depth, arena);
+}
+
+// Sequential MSD radix sort of a[0, n), whose strings share their first
+// `depth` bytes; tmp and oracle have room for n entries.
+inline void msd_sort(StringRef* a, StringRef* tmp, uint16_t* oracle, size_t n, size_t depth, const char* arena) {
+    size_t cnt[kBuckets];
+    while (n > kInsertionMax) {
+        std::fill_n(cnt, kBuckets, 0);
+        for (size_t i = 0; i < n; ++i) {
+            const unsigned c = char_at(arena, a[i], depth);
+            oracle[i] = static_cast<uint16_t>(c);
+            ++cnt[c];
+        }
+        if (cnt[oracle[0]] == n) {
+            if (oracle[0] == 0) return;  // all equal
+            depth = common_prefix(a, n, a[0], depth + 1, arena);
+            continue;
+        }
+
+        size_t off[kBuckets];
+        for (size_t k = 0, s = 0; k < kBuckets; s += cnt[k], ++k) off[k] = s;
+        for (size_t i = 0; i < n; ++i) tmp[off[oracle[i]]++] = a[i];
+        std::memcpy(static_cast<void*>(a), tmp, n * sizeof(StringRef));
+        ops::moved(2 * n, sizeof(StringRef));
+
+        for (size_t k = 1, s = cnt[0]; k < kBuckets; s += cnt[k], ++k) {
+            if (cnt[k] > 1) msd_sort(a + s, tmp + s, oracle + s, cnt[k], depth + 1, arena);
+        }
+        return;
+    }
+    lcp_insertion_sort(a, n, depth, arena);
+}
+
+// Parallel MSD radix sort: each level with more than kParallelMinChunk
+// strings per thread counts and scatters with parallel_for; buckets
+// larger than a thread's share get another parallel level, the rest go
+// to parallel_tasks, largest first. Counts are borrowed from ws.
+inline void parallel_msd_sort(StringRef* a, StringRef* tmp, uint16_t* oracle, size_t n, size_t depth,
+                              const char* arena, unsigned threads, SortWorkspace* ws) {
+    const size_t chunks = parallel_chunks(n, threads, kParallelMinChunk);
+    if (chunks <= 1) {
+        msd_sort(a, tmp, oracle, n, depth, arena);
+        return;
+    }
+
+    Scratch<size_t> hist(ws, chunks * kBuckets);
+    ops::scratch(chunks * kBuckets * sizeof(size_t));
+    size_t cnt[kBuckets];
+    while (true) {
+        std::fill_n(hist.data(), chunks * kBuckets, 0);
+        parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+            size_t* h = &hist[c * kBuckets];
+            for (size_t i = b; i < e; ++i) {
+                const unsigned ch = char_at(arena, a[i], depth);
+                oracle[i] = static_cast<uint16_t>(ch);
+                ++h[ch];
+            }
+        }, kParallelMinChunk);
+        std::fill_n(cnt, kBuckets, 0);
+        for (size_t c = 0; c < chunks; ++c) {
+            for (size_t k = 0; k < kBuckets; ++k) cnt[k] += hist[c * kBuckets + k];
+        }
+        if (cnt[oracle[0]] != n) break;
+        if (oracle[0] == 0) return;
+        std::fill_n(hist.data(), chunks, depth + 1);
+        parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+            hist[c] = common_prefix(a + b, e - b, a[0], depth + 1, arena);
+        }, kParallelMinChunk);
+        depth = *std::min_element(hist.data(), hist.data() + chunks);
+    }
+
+    // hist becomes each chunk's write offset per bucket, chunks in order within a bucket.
+    for (size_t k = 0, s = 0; k < kBuckets; ++k) {
+        for (size_t c = 0; c < chunks; ++c) {
+            const size_t v = hist[c * kBuckets + k];
+            hist[c * kBuckets + k] = s;
+            s += v;
+        }
+    }
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t c) {
+        size_t* o = &hist[c * kBuckets];
+        for (size_t i = b; i < e; ++i) tmp[o[oracle[i]]++] = a[i];
+    }, kParallelMinChunk);
+    parallel_for(n, threads, [&](size_t b, size_t e, size_t) {
+        std::memcpy(static_cast<void*>(a + b), tmp + b, (e - b) * sizeof(StringRef));
+    }, kParallelMinChunk);
+    ops::moved(2 * n, sizeof(StringRef));
+
+    const size_t share = n / resolve_threads(threads);
+    size_t start[kBuckets];
+    std::vector<size_t> small;
+    for (size_t k = 0, s = 0; k < kBuckets; s += cnt[k], ++k) {
+        start[k] = s;
+        if (k == 0 || cnt[k] < 2) continue;
+        if (cnt[k] > share) parallel_msd_sort(a + s, tmp + s, oracle + s, cnt[k], depth + 1, arena, threads, ws);
+        else small.push_back(k);
+    }
+    std::sort(small.begin(), small.end(), [&](size_t x, size_t y) { return cnt[x] > cnt[y]; });
+    parallel_tasks(small.size(), threads, [&](size_t i) {
+        const size_t k = small[i];
+        msd_sort(a + start[k], tmp + start[k], oracle + start[k], cnt[k], depth + 1, arena);
+    });
+}
+
+}
+
+// Base for the string sorters: the arena comes with the comparator, which
+// the runner also verifies with.
+class StringSorter : public Sorter<StringRef, StringRefLess> {
+public:
+    explicit StringSorter(StringRefLess cmp) : Sorter<StringRef, StringRefLess>(cmp), arena_(cmp.arena) {}
+
+protected:
+    const char* arena_;
+};
+
+// std::sort on the handles with StringRefLess, for the prefix cache alone.
+class StringStdSorter final : public StringSorter {
+public:
+    using StringSorter::StringSorter;
+    std::string name() const override { return "std::sort(handles)"; }
+    void sort(std::vector<StringRef>& a) override { std::sort(a.begin(), a.end(), cmp_); }
+};
+
+class MultikeyQuicksorter final : public StringSorter {
+public:
+    using StringSorter::StringSorter;
+    std::string name() const override { return "MultikeyQuicksort"; }
+
+    void sort(std::vector<StringRef>& a) override {
+        const size_t n = a.size();
+        Scratch<uint64_t> cache(workspace_, n);
+        ops::scratch(n * sizeof(uint64_t));
+        for (size_t i = 0; i < n; ++i) cache[i] = a[i].prefix;
+        strsort::multikey_quicksort(a.data(), cache.data(), n, 0, arena_);
+    }
+};
+
+// threads == 1 is the sequential MSD sort, 0 uses every CPU.
+class StringMsdSorter final : public StringSorter {
+public:
+    StringMsdSorter(StringRefLess cmp, unsigned threads = 1) : StringSorter(cmp), threads_(threads) {}
+
+    std::string name() const override { return threads_ == 1 ? "StringMSD" : "StringMSD(parallel)"; }
+    bool parallel() const override { return resolve_threads(threads_) > 1; }
+
+    void sort(std::vector<StringRef>& a) override {
+        const size_t n = a.size();
+        Scratch<StringRef> tmp(workspace_, n);
+        Scratch<uint16_t> oracle(workspace_, n);
+        ops::scratch(n * (sizeof(StringRef) + sizeof(uint16_t)));
+        if (threads_ == 1) strsort::msd_sort(a.data(), tmp.data(), oracle.data(), n, 0, arena_);
+        else strsort::parallel_msd_sort(a.data(), tmp.data(), oracle.data(), n, 0, arena_, threads_, workspace_);
+    }
+
+private:
+    unsigned threads_;
+};
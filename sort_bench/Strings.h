@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Variable-length keys. The bytes of every string sit back to back in one
+// arena and sorters move 16-byte handles instead of the strings. A handle
+// caches the string's first 8 bytes, big-endian and zero-padded, so that
+// comparing two prefixes as integers orders the strings by those bytes and
+// most comparisons never touch the arena.
+struct StringRef {
+    uint64_t prefix;
+    uint32_t offset;
+    uint32_t length;
+};
+
+// Up to 8 bytes of s[0, len) as a big-endian integer, zero-padded.
+inline uint64_t load_prefix(const char* s, size_t len) {
+    uint64_t w = 0;
+    const size_t k = std::min<size_t>(len, 8);
+    for (size_t i = 0; i < k; ++i) w |= uint64_t(static_cast<unsigned char>(s[i])) << (56 - 8 * i);
+    return w;
+}
+
+// Byte-wise order with bytes unsigned, a string before any it is a proper
+// prefix of; the order std::string's operator< gives. Equal prefixes with
+// at most 8 bytes in the shorter string mean it is a prefix of the other,
+// so the lengths decide.
+struct StringRefLess {
+    const char* arena{nullptr};
+
+    bool operator()(const StringRef& a, const StringRef& b) const {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix;
+        const uint32_t m = std::min(a.length, b.length);
+        if (m > 8) {
+            const int c = std::memcmp(arena + a.offset + 8, arena + b.offset + 8, m - 8);
+            if (c != 0) return c < 0;
+        }
+        return a.length < b.length;
+    }
+};
+
+// An arena and the handles into it. Offsets are 32-bit, so the arena holds
+// at most 4 GB. The arena may move while strings are added; take less()
+// and arena() once the set is complete.
+class StringSet {
+public:
+    void reserve(size_t strings, size_t bytes) {
+        refs_.reserve(strings);
+        bytes_.reserve(bytes);
+    }
+
+    void add(const char* s, size_t len) {
+        refs_.push_back({load_prefix(s, len), static_cast<uint32_t>(bytes_.size()), static_cast<uint32_t>(len)});
+        bytes_.insert(bytes_.end(), s, s + len);
+    }
+
+    size_t size() const { return refs_.size(); }
+    size_t bytes() const { return bytes_.size(); }
+    const char* arena() const { return bytes_.data(); }
+    StringRefLess less() const { return {bytes_.data()}; }
+
+    const std::vector<StringRef>& refs() const { return refs_; }
+    std::string_view view(const StringRef& r) const { return {bytes_.data() + r.offset, r.length}; }
+
+    // The strings as std::string, in handle order.
+    std::vector<std::string> to_strings() const {
+        std::vector<std::string> out;
+        out.reserve(refs_.size());
+        for (const StringRef& r : refs_) out.emplace_back(view(r));
+        return out;
+    }
+
+private:
+    std::vector<char> bytes_;
+    std::vector<StringRef> refs_;
+};
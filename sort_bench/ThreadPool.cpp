@@ -0,0 +1,97 @@
+#include "ThreadPool.h"
+#include "Parallel.h"
+
+namespace {
+
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local unsigned tlsQueue = 0;
+
+}
+
+ThreadPool::ThreadPool(unsigned threads) : threads_(resolve_threads(threads)) {
+    queues_.reserve(threads_);
+    for (unsigned i = 0; i < threads_; ++i) queues_.push_back(std::make_unique<Queue>());
+
+    workers_.reserve(threads_ - 1);
+    for (unsigned i = 1; i < threads_; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx_);
+        stop_ = true;
+    }
+    sleepCv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+unsigned ThreadPool::currentQueue() const {
+    return tlsPool == this ? tlsQueue : 0;
+}
+
+// The task is counted before it is pushed, so queued_ never falls below
+// the number of tasks in the queues, and under sleepMtx_, so a worker
+// that has just seen queued_ == 0 is already waiting when notified.
+void ThreadPool::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx_);
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Queue& q = *queues_[currentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(q.mtx);
+        q.tasks.push_back(std::move(task));
+    }
+    sleepCv_.notify_one();
+}
+
+bool ThreadPool::pop(unsigned self, Task& out) {
+    {
+        Queue& q = *queues_[self];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (unsigned k = 1; k < threads_; ++k) {
+        Queue& q = *queues_[(self + k) % threads_];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::tryRunOne() {
+    Task task;
+    if (!pop(currentQueue(), task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    tlsPool = this;
+    tlsQueue = index;
+
+    Task task;
+    while (true) {
+        if (pop(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMtx_);
+        sleepCv_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_relaxed) > 0; });
+        if (stop_) break;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing pool. Each worker owns a deque: it pushes and pops at the
+// back (LIFO, cache-warm), idle workers steal from the front of others
+// (FIFO, the biggest remaining subproblems). The thread that waits on a
+// TaskGroup helps run tasks, so `threads` counts the caller and the pool
+// spawns threads - 1 workers; a pool of 1 runs everything inline.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned threads() const { return threads_; }
+
+    void submit(Task task);
+
+    // Runs one queued task on the calling thread; false if none was found.
+    bool tryRunOne();
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    bool pop(unsigned self, Task& out);
+    unsigned currentQueue() const;
+
+    unsigned threads_;
+    std::vector<std::unique_ptr<Queue>> queues_;  // queues_[0] is shared by non-worker threads
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex sleepMtx_;
+    std::condition_variable sleepCv_;
+};
+
+// Fork-join scope: run() forks a task, wait() joins all of them while
+// helping the pool, so nested groups never block a worker.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <typename Fn>
+    void run(Fn&& fn) {
+        if (pool_.threads() <= 1) {
+            fn();
+            return;
+        }
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        pool_.submit([this, f = std::forward<Fn>(fn)]() mutable {
+            f();
+            pending_.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        while (pending_.load(std::memory_order_acquire) > 0) {
+            if (!pool_.tryRunOne()) std::this_thread::yield();
+        }
+    }
+
+private:
+    ThreadPool& pool_;
+    std::atomic<size_t> pending_{0};
+};
@@ -1,34 +1,945 @@
 #include "SortAlgorithms.h"
+#include "AdaptiveSort.h"
+#include "Argsort.h"
+#include "ExternalSort.h"
+#include "IncrementalSort.h"
+#include "NaturalMergeSort.h"
+#include "ParallelMergeSort.h"
+#include "PdqSort.h"
+#include "RadixSort.h"
+#include "SampleSort.h"
+#include "Select.h"
+#include "SegmentedSort.h"
+#include "SortWorkspace.h"
+#include "StringSort.h"
 #include "DataGenerator.h"
+#include "Dataset.h"
 #include "BenchmarkRunner.h"
 #include "Report.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
 
-int main() {
-    auto sorters = make_default_sorters();
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
 
-    BenchConfig bc;
-    bc.repeats = 3;
-     bc.n2Cutoff = 20000;
+static const char* flag_value(const char* arg, const char* name) {
+    size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) == 0 && arg[len] == '=') return arg + len + 1;
+    return nullptr;
+}
+
+template <typename T>
+static void run_sweep(BenchmarkRunner& runner, const std::vector<DataPattern>& patterns,
+                      const std::vector<int>& sizes, const std::string& cacheDir,
+                      std::vector<Report::Entry>& entries) {
+    auto sorters = make_default_sorters<T>();
+
+    for (DataPattern pattern : patterns) {
+        std::cout << "\n=== key: " << key_name<T>() << " (" << sizeof(T) << " bytes)"
+                  << ", pattern: " << to_string(pattern) << " ===\n";
+        runner.setSeries(to_string(pattern));
+        for (int N : sizes) {
+            DataGenConfig dg;
+            dg.n = N;
+            dg.minValue = 0;
+            dg.maxValue = 1000000;
+            dg.pattern = pattern;
+            dg.seed = 42;
+
+            // With a cache the runner copies each repeat from the mapped
+            // file; a cache that cannot be used falls back to generating.
+            std::vector<BenchResult> results;
+            Dataset<T> cached;
+            std::string error;
+            if (!cacheDir.empty() && DatasetCache(cacheDir).load(dg, cached, error)) {
+                results = runner.run(cached.data(), cached.size(), sorters);
+            } else {
+                if (!cacheDir.empty()) std::cerr << "warning: " << error << ", generating instead\n";
+                results = runner.run(DataGenerator(dg).generate_as<T>(), sorters);
+            }
+            Report::print(N, runner.config().repeats, results);
+            for (const BenchResult& r : results) entries.push_back({key_name<T>(), to_string(pattern), 0, r});
+        }
+    }
+}
+
+// Parallel sorters at 1, 2, 4, ... threads up to the hardware count.
+template <typename T>
+static void run_scaling(BenchmarkRunner& runner, DataPattern pattern, int n, std::vector<Report::Entry>& entries) {
+    DataGenConfig dg;
+    dg.n = n;
+    dg.minValue = 0;
+    dg.maxValue = 1000000;
+    dg.pattern = pattern;
+    dg.seed = 42;
+    auto data = DataGenerator(dg).generate_as<T>();
+
+    std::vector<unsigned> counts;
+    const unsigned hw = resolve_threads(0);
+    for (unsigned t = 1; t < hw; t *= 2) counts.push_back(t);
+    counts.push_back(hw);
+
+    std::cout << "\n=== key: " << key_name<T>() << ", pattern: " << to_string(pattern) << " ===\n";
+    std::vector<Report::ScalingPoint> points;
+    for (unsigned t : counts) {
+        std::vector<std::unique_ptr<ISorterT<T>>> sorters;
+        sorters.push_back(std::make_unique<ParallelMergeSorter<T>>(t));
+        sorters.push_back(std::make_unique<SampleSorter<T>>(t));
+        sorters.push_back(std::make_unique<RadixSorter<T>>(t));
+        points.push_back({t, runner.run(data, sorters)});
+        for (const BenchResult& r : points.back().results) entries.push_back({key_name<T>(), to_string(pattern), t, r});
+    }
+    Report::printScaling(n, points);
+
+    // One socket on its own: all threads and all bucket memory on one node.
+    std::vector<Report::SocketPoint> sockets;
+    for (size_t k = 0; k < numa::nodes().size(); ++k) {
+        std::vector<std::unique_ptr<ISorterT<T>>> sorters;
+        auto sorter = std::make_unique<SampleSorter<T>>(0, static_cast<int>(k));
+        const unsigned t = sorter->threads();
+        sorters.push_back(std::move(sorter));
+        const BenchResult r = runner.run(data, sorters).front();
+        sockets.push_back({numa::nodes()[k].id, t, r});
+        entries.push_back({key_name<T>(), to_string(pattern), t, r});
+    }
+    Report::printSockets(n, sockets);
+}
+
+static long minor_faults() {
+#if !defined(_WIN32)
+    rusage u;
+    if (getrusage(RUSAGE_SELF, &u) == 0) return u.ru_minflt;
+#endif
+    return -1;
+}
+
+// Sorts the input as consecutive batches of `batch` elements, one inner
+// sort() call each, the way a service sorting many small requests would.
+// The note gives the minor page faults per batch and, when the inner
+// sorter has a workspace, its size and backing.
+template <typename T>
+class BatchSorter final : public ISorterT<T> {
+public:
+    BatchSorter(std::unique_ptr<ISorterT<T>> inner, size_t batch) : inner_(std::move(inner)), batch_(batch) {}
+
+    std::string name() const override { return inner_->name() + (inner_->workspace() ? " +ws" : ""); }
+    bool supports(const std::vector<T>& a, std::string& reason) const override { return inner_->supports(a, reason); }
+    bool parallel() const override { return inner_->parallel(); }
+    bool keepsThreads() const override { return inner_->keepsThreads(); }
+    std::string note() const override { return note_; }
+
+    void sort(std::vector<T>& a) override {
+        const long faults = minor_faults();
+        size_t batches = 0;
+        for (size_t b = 0; b < a.size(); b += batch_, ++batches) {
+            part_.assign(a.begin() + b, a.begin() + std::min(a.size(), b + batch_));
+            inner_->sort(part_);
+            std::copy(part_.begin(), part_.end(), a.begin() + b);
+        }
+
+        char buf[128] = "";
+        int len = 0;
+        if (faults >= 0 && batches > 0) {
+            len = std::snprintf(buf, sizeof(buf), "%.2f faults/batch",
+                                static_cast<double>(minor_faults() - faults) / static_cast<double>(batches));
+        }
+        if (const SortWorkspace* ws = inner_->workspace()) {
+            std::snprintf(buf + len, sizeof(buf) - len, "%sws %zu KB %s", len ? ", " : "",
+                          ws->capacity() >> 10, to_string(ws->backing()));
+        }
+        note_ = buf;
+    }
+
+private:
+    std::unique_ptr<ISorterT<T>> inner_;
+    size_t batch_;
+    std::vector<T> part_;
+    std::string note_;
+};
+
+// Many small sorts: about kBatchTotal elements per run, cut into batches
+// of each size in `sizes`. Each batch is an independent instance of the
+// pattern, offset so the batches together are sorted once each one is.
+// The sorters that need scratch run twice, allocating per call and
+// borrowing from one shared workspace.
+template <typename T>
+static void run_batches(BenchmarkRunner& runner, DataPattern pattern, const std::vector<int>& sizes,
+                        std::vector<Report::Entry>& entries) {
+    constexpr size_t kBatchTotal = size_t(1) << 20;
+    SortWorkspace ws;
+
+    std::cout << "\n=== key: " << key_name<T>() << ", pattern: " << to_string(pattern) << ", many small sorts ===\n";
+    for (int size : sizes) {
+        const size_t batch = static_cast<size_t>(std::max(size, 1));
+        const size_t batches = std::max<size_t>(1, kBatchTotal / batch);
+        const int64_t span = std::min<int64_t>(1000000, INT32_MAX / static_cast<int64_t>(batches));
+
+        std::vector<T> data;
+        data.reserve(batches * batch);
+        for (size_t i = 0; i < batches; ++i) {
+            DataGenConfig dg;
+            dg.n = batch;
+            dg.maxValue = span - 1;
+            dg.pattern = pattern;
+            dg.seed = 42 + i;
+            for (int64_t v : DataGenerator(dg).generate_as<int64_t>()) {
+                data.push_back(KeyTraits<T>::make(static_cast<int64_t>(i) * span + v, data.size()));
+            }
+        }
+
+        std::vector<std::unique_ptr<ISorterT<T>>> sorters;
+        auto add = [&](auto make) {
+            sorters.push_back(std::make_unique<BatchSorter<T>>(make(), batch));
+            auto borrowing = make();
+            borrowing->setWorkspace(&ws);
+            sorters.push_back(std::make_unique<BatchSorter<T>>(std::move(borrowing), batch));
+        };
+        add([] { return std::make_unique<MergeSorter<T>>(); });
+        add([] { return std::make_unique<NaturalMergeSorter<T>>(); });
+        add([] { return std::make_unique<RadixSorter<T>>(1); });
+        add([] { return std::make_unique<AdaptiveSorter<T>>(1); });
+        sorters.push_back(std::make_unique<BatchSorter<T>>(std::make_unique<PdqSorter<T>>(), batch));
+        sorters.push_back(std::make_unique<BatchSorter<T>>(std::make_unique<StdSortIntrosort<T>>(), batch));
+
+        std::cout << "\n" << batches << " batches of " << batch << "\n";
+        auto results = runner.run(data, sorters);
+        Report::print(static_cast<int>(data.size()), runner.config().repeats, results);
+        const std::string label = std::string(to_string(pattern)) + "/batch" + std::to_string(batch);
+        for (const BenchResult& r : results) entries.push_back({key_name<T>(), label, 0, r});
+    }
+}
 
-     BenchmarkRunner runner(bc);
+// Many small sorts packed into one buffer with an offsets array: about
+// kSegmentTotal elements per run, cut into segments of each length in
+// `sizes` and then into segments of random length from 8 to 512. As in
+// run_batches each segment's keys are offset so the whole buffer is sorted
+// once every segment is. Besides the table, throughput is reported in
+// segments per second.
+template <typename T>
+static void run_segments(BenchmarkRunner& runner, DataPattern pattern, const std::vector<int>& sizes,
+                         std::vector<Report::Entry>& entries) {
+    constexpr size_t kSegmentTotal = size_t(1) << 22;
+    constexpr size_t kMixedMin = 8, kMixedMax = 512;
 
-     std::vector<int> sizes = {1000, 5000, 20000, 100000};
+    std::cout << "\n=== key: " << key_name<T>() << ", pattern: " << to_string(pattern) << ", segmented sort ===\n";
+    std::vector<int> lengths = sizes;
+    lengths.push_back(0);  // mixed
+    for (int length : lengths) {
+        std::vector<size_t> offsets = {0};
+        std::mt19937_64 rng(42);
+        while (offsets.back() < kSegmentTotal) {
+            size_t len = length > 0 ? static_cast<size_t>(length) : kMixedMin + rng() % (kMixedMax - kMixedMin + 1);
+            offsets.push_back(offsets.back() + len);
+        }
+        const size_t segments = offsets.size() - 1;
+        const int64_t span = std::min<int64_t>(1000000, INT32_MAX / static_cast<int64_t>(segments));
 
-     for (int N : sizes) {
         DataGenConfig dg;
-        dg.n = N;
-        dg.minValue = 0;
-        dg.maxValue = 1000000;
-        dg.pattern = DataPattern::Random;
+        dg.n = offsets.back();
+        dg.maxValue = span - 1;
+        dg.pattern = pattern;
         dg.seed = 42;
+        const std::vector<int64_t> values = DataGenerator(dg).generate_as<int64_t>();
+        std::vector<T> data;
+        data.reserve(values.size());
+        for (size_t s = 0; s < segments; ++s) {
+            for (size_t i = offsets[s]; i < offsets[s + 1]; ++i) {
+                data.push_back(KeyTraits<T>::make(static_cast<int64_t>(s) * span + values[i], i));
+            }
+        }
 
-        DataGenerator gen(dg);
-        auto data = gen.generate();
+        using Method = typename SegmentedSorter<T>::Method;
+        std::vector<std::unique_ptr<ISorterT<T>>> sorters;
+        sorters.push_back(std::make_unique<SegmentedSorter<T>>(Method::Auto, offsets, 1));
+        sorters.push_back(std::make_unique<SegmentedSorter<T>>(Method::Auto, offsets, 0));
+        sorters.push_back(std::make_unique<SegmentedSorter<T>>(Method::Insertion, offsets));
+        sorters.push_back(std::make_unique<SegmentedSorter<T>>(Method::Pdq, offsets));
+        sorters.push_back(std::make_unique<SegmentedSorter<T>>(Method::Std, offsets));
+        if (length > 0) {
+            // One virtual sort() on a std::vector per segment.
+            sorters.push_back(std::make_unique<BatchSorter<T>>(std::make_unique<PdqSorter<T>>(), length));
+        }
 
+        const std::string desc = length > 0 ? std::to_string(length) : std::to_string(kMixedMin) + "-" + std::to_string(kMixedMax);
+        std::cout << "\n" << segments << " segments of " << desc << "\n";
         auto results = runner.run(data, sorters);
-        Report::print(N, bc.repeats, results);
+        Report::print(static_cast<int>(data.size()), runner.config().repeats, results);
+        Report::printRate("segments", static_cast<double>(segments), results);
+        const std::string label = std::string(to_string(pattern)) + "/seg" + desc;
+        for (const BenchResult& r : results) entries.push_back({key_name<T>(), label, 0, r});
+    }
+}
+
+// A sorted array of n keys under a stream of updates: each of kTicks
+// ticks appends `delta` new keys and deletes a quarter as many that the
+// previous tick added, and must leave the array sorted. Every tick is
+// timed on its own, so the table's times are per-tick latencies and
+// ns/elem is per new key. Methods: SortedArray with an unbounded and a
+// bounded merge buffer, a std::sort of the delta plus std::inplace_merge,
+// and a full re-sort with std::sort. The re-sort's final array is the
+// reference the others must match.
+template <typename T>
+static void run_incremental(DataPattern pattern, int n, std::vector<Report::Entry>& entries) {
+    constexpr size_t kTicks = 64;
+    constexpr size_t kBoundedBuffer = 256;
+    enum class Method { Resort, Incremental, Bounded, InplaceMerge };
+    using Compare = typename KeyTraits<T>::Compare;
+
+    std::cout << "\n=== key: " << key_name<T>() << ", pattern: " << to_string(pattern) << ", incremental updates ===\n";
+    for (size_t delta : {size_t(256), size_t(4096)}) {
+        const size_t base = static_cast<size_t>(std::max(n, 1));
+        const size_t deletes = delta / 4;
+        DataGenConfig dg;
+        dg.n = base + kTicks * delta;
+        dg.maxValue = 1000000000;
+        dg.pattern = pattern;
+        dg.seed = 42;
+        const std::vector<T> keys = DataGenerator(dg).generate_as<T>();
+        std::vector<T> initial(keys.begin(), keys.begin() + static_cast<ptrdiff_t>(base));
+        std::sort(initial.begin(), initial.end(), Compare());
+        auto added = [&](size_t t) { return keys.data() + base + t * delta; };
+        auto removed = [&](size_t t) { return t == 0 ? keys.data() : added(t - 1); };
+
+        Compare cmp;
+        auto erase = [&](std::vector<T>& a, const T* del) {
+            std::vector<T> sorted(del, del + deletes);
+            std::sort(sorted.begin(), sorted.end(), cmp);
+            a.resize(incremental::erase_sorted(a.data(), a.size(), sorted.data(), deletes, cmp));
+        };
+
+        std::vector<BenchResult> results;
+        std::vector<T> reference;
+        for (Method m : {Method::Resort, Method::Incremental, Method::Bounded, Method::InplaceMerge}) {
+            BenchResult r;
+            r.n = base;
+            incremental::SortedArray<T> sorted(m == Method::Bounded ? kBoundedBuffer : 0);
+            StdSortIntrosort<T> resort;
+            std::vector<T> a;
+            a.reserve(base + kTicks * delta);
+            switch (m) {
+                case Method::Resort: r.sorter = "re-sort(" + resort.name() + ")"; break;
+                case Method::Incremental: r.sorter = "SortedArray"; break;
+                case Method::Bounded: r.sorter = "SortedArray(buf " + std::to_string(kBoundedBuffer) + ")"; break;
+                case Method::InplaceMerge: r.sorter = "std::sort+inplace_merge"; break;
+            }
+            if (m == Method::Incremental || m == Method::Bounded) {
+                sorted.assign(initial);
+                sorted.reserve(base + kTicks * delta);
+            } else {
+                a = initial;
+            }
+
+            std::vector<double> samples;
+            alloc::begin();
+            for (size_t t = 0; t < kTicks; ++t) {
+                const auto t0 = BenchmarkRunner::Clock::now();
+                switch (m) {
+                    case Method::Resort:
+                        a.insert(a.end(), added(t), added(t) + delta);
+                        resort.sort(a);
+                        erase(a, removed(t));
+                        break;
+                    case Method::Incremental:
+                    case Method::Bounded:
+                        sorted.insert(added(t), delta);
+                        sorted.erase(removed(t), deletes);
+                        break;
+                    case Method::InplaceMerge: {
+                        const ptrdiff_t mid = static_cast<ptrdiff_t>(a.size());
+                        a.insert(a.end(), added(t), added(t) + delta);
+                        std::sort(a.begin() + mid, a.end(), cmp);
+                        std::inplace_merge(a.begin(), a.begin() + mid, a.end(), cmp);
+                        erase(a, removed(t));
+                        break;
+                    }
+                }
+                const auto t1 = BenchmarkRunner::Clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            }
+            r.mem = alloc::end();
+
+            const std::vector<T>& out = m == Method::Incremental || m == Method::Bounded ? sorted.data() : a;
+            if (m == Method::Resort) reference = out;
+            auto equivalent = [&](const T& x, const T& y) { return !cmp(x, y) && !cmp(y, x); };
+            r.verified = std::is_sorted(out.begin(), out.end(), cmp) && out.size() == reference.size() &&
+                         std::equal(out.begin(), out.end(), reference.begin(), equivalent);
+            if (!r.verified) r.reason = "output mismatch";
+            r.samplesNs = samples;
+            r.stats = compute_stats(std::move(samples));
+            r.nsPerElement = r.stats.medianNs / static_cast<double>(delta);
+            results.push_back(std::move(r));
+        }
+
+        std::cout << "\n" << base << " keys, +" << delta << " / -" << deletes << " per tick, " << kTicks << " ticks\n";
+        Report::print(static_cast<int>(base), static_cast<int>(kTicks), results);
+        const std::string label = std::string(to_string(pattern)) + "/delta" + std::to_string(delta);
+        for (const BenchResult& r : results) entries.push_back({key_name<T>(), label, 0, r});
+    }
+}
+
+// The k smallest of n, in order, for k from 1 up to n / 2 (the median):
+// heap partial sort, Floyd-Rivest select plus a sort of the prefix, their
+// std:: counterparts and the streaming top-k, against a full pdqsort.
+template <typename T>
+static void run_topk(BenchmarkRunner& runner, DataPattern pattern, int n, std::vector<Report::Entry>& entries) {
+    DataGenConfig dg;
+    dg.n = n;
+    dg.maxValue = 1000000;
+    dg.pattern = pattern;
+    dg.seed = 42;
+    auto data = DataGenerator(dg).generate_as<T>();
+
+    std::vector<size_t> ks;
+    for (size_t k = 1; k <= static_cast<size_t>(n) / 10; k *= 10) ks.push_back(k);
+    if (n >= 2) ks.push_back(static_cast<size_t>(n) / 2);
+
+    using Method = typename TopKSorter<T>::Method;
+    std::cout << "\n=== key: " << key_name<T>() << ", pattern: " << to_string(pattern) << ", k smallest of " << n << " ===\n";
+    for (size_t k : ks) {
+        std::vector<std::unique_ptr<ISorterT<T>>> sorters;
+        for (Method m : {Method::Heap, Method::Select, Method::StdPartial, Method::StdNth, Method::Stream,
+                         Method::StreamSimd}) {
+            sorters.push_back(std::make_unique<TopKSorter<T>>(m, k));
+        }
+        sorters.push_back(std::make_unique<PdqSorter<T>>());
+
+        std::cout << "\nk = " << k << "\n";
+        auto results = runner.run(data, sorters);
+        Report::print(n, runner.config().repeats, results);
+        const std::string label = std::string(to_string(pattern)) + "/k" + std::to_string(k);
+        for (const BenchResult& r : results) entries.push_back({key_name<T>(), label, 0, r});
+    }
+}
+
+// Sorts a key column and reorders the payload columns of the same rows to
+// match, the structure-of-arrays counterpart of sorting WideRecord<Bytes>:
+// either argsort and a gather of every column including the keys, or
+// sort_by_key and a gather of the payload only. Payload is gathered from
+// the generated columns into separate output columns, so every run does
+// the same work. The first sort of the whole input checks the output rows
+// and the note reports the result.
+template <size_t Bytes>
+class ColumnSorter final : public ISorterT<uint64_t> {
+public:
+    ColumnSorter(bool argsortKeys, const std::vector<uint64_t>& keys)
+        : argsort_(argsortKeys), keys_(keys), columns_(Bytes / 8 - 1), out_(Bytes / 8 - 1) {
+        for (std::vector<uint64_t>& c : columns_) {
+            c.resize(keys.size());
+            for (size_t i = 0; i < c.size(); ++i) c[i] = i;
+        }
+    }
+
+    std::string name() const override { return argsort_ ? "argsort+gather" : "sort_by_key+gather"; }
+    bool parallel() const override { return resolve_threads(0) > 1; }
+    std::string note() const override { return checked_ ? (rowsOk_ ? "rows verified" : "FAILED: rows do not match") : ""; }
+
+    void sort(std::vector<uint64_t>& a) override {
+        const size_t n = a.size();
+        perm_.resize(n);
+        if (argsort_) {
+            argsort::argsort(a.data(), n, perm_.data(), std::less<uint64_t>(), 0, workspace_);
+            argsort::permute(a.data(), perm_.data(), n, workspace_);
+        } else {
+            argsort::sort_by_key(a.data(), n, perm_.data(), std::less<uint64_t>(), 0, workspace_);
+        }
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            out_[c].resize(n);
+            argsort::gather(columns_[c].data(), perm_.data(), n, out_[c].data());
+        }
+        if (!checked_ && n == keys_.size()) {
+            checked_ = true;
+            rowsOk_ = rows_match(a);
+        }
+    }
+
+private:
+    // Each output row must carry the payload of an input row with the same
+    // key, rows with equal keys in input order.
+    bool rows_match(const std::vector<uint64_t>& sorted) const {
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            const uint64_t row = out_[0][i];
+            if (row >= keys_.size() || keys_[row] != sorted[i]) return false;
+            if (i > 0 && sorted[i] == sorted[i - 1] && row <= out_[0][i - 1]) return false;
+            for (const std::vector<uint64_t>& c : out_) {
+                if (c[i] != row) return false;
+            }
+        }
+        return true;
+    }
 
+    bool argsort_;
+    const std::vector<uint64_t>& keys_;
+    std::vector<std::vector<uint64_t>> columns_;
+    std::vector<std::vector<uint64_t>> out_;
+    std::vector<uint32_t> perm_;
+    bool checked_{false};
+    bool rowsOk_{false};
+};
+
+// Rows of Bytes (a uint64 key and payload words) sorted by key in three
+// layouts: as an array of structs by every row sorter, as a key column
+// plus payload columns through an index permutation, and as an array of
+// structs through a sorted index, pointer or key+index array and one
+// gather. SoA needs at least one payload column, so 8-byte rows skip it.
+// The x std::sort column compares every layout against std::sort on the
+// structs. All sorters share one workspace.
+template <size_t Bytes>
+static void run_records_case(BenchmarkRunner& runner, DataPattern pattern, int n,
+                             std::vector<Report::Entry>& entries) {
+    using Row = WideRecord<Bytes>;
+    DataGenConfig dg;
+    dg.n = n;
+    dg.maxValue = 1000000;
+    dg.pattern = pattern;
+    dg.seed = 42;
+    const std::vector<uint64_t> keys = DataGenerator(dg).generate_as<uint64_t>();
+    std::vector<Row> rows;
+    rows.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) rows.push_back(KeyTraits<Row>::make(static_cast<int64_t>(keys[i]), i));
+
+    SortWorkspace ws;
+    std::vector<std::unique_ptr<ISorterT<Row>>> rowSorters;
+    rowSorters.push_back(std::make_unique<StdSortIntrosort<Row>>());
+    rowSorters.push_back(std::make_unique<StdStableSort<Row>>());
+    rowSorters.push_back(std::make_unique<PdqSorter<Row>>());
+    rowSorters.push_back(std::make_unique<NaturalMergeSorter<Row>>());
+    rowSorters.push_back(std::make_unique<RadixSorter<Row>>());
+    std::vector<std::unique_ptr<ISorterT<Row>>> indirectSorters;
+    indirectSorters.push_back(std::make_unique<IndirectSorter<Row>>(argsort::Indirect::Index));
+    indirectSorters.push_back(std::make_unique<IndirectSorter<Row>>(argsort::Indirect::Pointer));
+    indirectSorters.push_back(std::make_unique<IndirectSorter<Row>>(argsort::Indirect::KeyIndex));
+    std::vector<std::unique_ptr<ISorterT<uint64_t>>> columnSorters;
+    if constexpr (Bytes > 8) {
+        columnSorters.push_back(std::make_unique<ColumnSorter<Bytes>>(true, keys));
+        columnSorters.push_back(std::make_unique<ColumnSorter<Bytes>>(false, keys));
+    }
+    for (auto& s : rowSorters) s->setWorkspace(&ws);
+    for (auto& s : indirectSorters) s->setWorkspace(&ws);
+    for (auto& s : columnSorters) s->setWorkspace(&ws);
+
+    std::cout << "\n" << Bytes << "-byte rows: array of structs, key + " << Bytes / 8 - 1
+              << " payload columns, then indirect\n";
+    std::vector<BenchResult> results;
+    std::vector<const char*> layouts;
+    auto add = [&](std::vector<BenchResult> rs, const char* layout) {
+        for (BenchResult& r : rs) {
+            results.push_back(std::move(r));
+            layouts.push_back(layout);
+        }
+    };
+    add(runner.run(rows, rowSorters), "aos");
+    if (!columnSorters.empty()) add(runner.run(keys, columnSorters), "soa");
+    add(runner.run(rows, indirectSorters), "indirect");
+    Report::print(n, runner.config().repeats, results);
+    const std::string label = "record" + std::to_string(Bytes);
+    for (size_t i = 0; i < results.size(); ++i) {
+        entries.push_back({label, std::string(to_string(pattern)) + "/" + layouts[i], 0, results[i]});
+    }
+}
+
+static void run_records(BenchmarkRunner& runner, DataPattern pattern, int n, const std::vector<int>& recordBytes,
+                        std::vector<Report::Entry>& entries) {
+    std::cout << "\n=== pattern: " << to_string(pattern) << ", sort by key with payload ===\n";
+    for (int bytes : recordBytes) {
+        switch (bytes) {
+            case 8: run_records_case<8>(runner, pattern, n, entries); break;
+            case 16: run_records_case<16>(runner, pattern, n, entries); break;
+            case 32: run_records_case<32>(runner, pattern, n, entries); break;
+            case 64: run_records_case<64>(runner, pattern, n, entries); break;
+            case 128: run_records_case<128>(runner, pattern, n, entries); break;
+            case 256: run_records_case<256>(runner, pattern, n, entries); break;
+        }
+    }
+}
+
+// std::sort on the strings as std::vector<std::string>, timed the way the
+// runner times a sorter: warmup runs first, at least one, and a fresh copy
+// of the input before every run, outside the timed region.
+static BenchResult run_std_strings(const BenchConfig& cfg, const StringSet& set) {
+    BenchResult r;
+    r.sorter = "std::sort(Introsort)";
+    r.n = set.size();
+    const std::vector<std::string> input = set.to_strings();
+    std::vector<std::string> work;
+    std::vector<double> samples;
+    const int warmup = std::max(1, cfg.warmup);  // the first run measures memory and is never timed
+    for (int i = 0; i < warmup + std::max(1, cfg.repeats); ++i) {
+        work = input;
+        if (i == 0) alloc::begin();
+        const auto t0 = BenchmarkRunner::Clock::now();
+        std::sort(work.begin(), work.end());
+        const auto t1 = BenchmarkRunner::Clock::now();
+        if (i == 0) r.mem = alloc::end();
+        if (i >= warmup) samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    r.verified = std::is_sorted(work.begin(), work.end());
+    if (!r.verified) r.reason = "output not sorted";
+    r.samplesNs = samples;
+    r.stats = compute_stats(std::move(samples));
+    r.nsPerElement = r.stats.medianNs / static_cast<double>(std::max<size_t>(1, r.n));
+    return r;
+}
+
+// Strings sharing a prefix of 0, 16 and 64 bytes. The handle sorters run
+// through the runner; std::sort on std::vector<std::string> is the
+// baseline the "x std::sort" column refers to.
+static void run_strings(BenchmarkRunner& runner, DataPattern pattern, int n, std::vector<Report::Entry>& entries) {
+    std::cout << "\n=== key: string, pattern: " << to_string(pattern) << " ===\n";
+    for (size_t prefix : {size_t(0), size_t(16), size_t(64)}) {
+        DataGenConfig dg;
+        dg.n = n;
+        dg.maxValue = 1000000000;
+        dg.pattern = pattern;
+        dg.seed = 42;
+        dg.sharedPrefix = prefix;
+        const StringSet set = DataGenerator(dg).generate_strings();
+        const StringRefLess less = set.less();
+
+        std::vector<std::unique_ptr<ISorterT<StringRef>>> sorters;
+        sorters.push_back(std::make_unique<StringStdSorter>(less));
+        sorters.push_back(std::make_unique<MultikeyQuicksorter>(less));
+        sorters.push_back(std::make_unique<StringMsdSorter>(less));
+        sorters.push_back(std::make_unique<StringMsdSorter>(less, 0));
+        std::vector<BenchResult> results = runner.run(set.refs(), sorters, less);
+        results.insert(results.begin(), run_std_strings(runner.config(), set));
+
+        std::cout << "\nshared prefix " << prefix << " bytes, mean length "
+                  << set.bytes() / std::max<size_t>(1, set.size()) << " bytes\n";
+        Report::print(n, runner.config().repeats, results);
+        const std::string label = std::string(to_string(pattern)) + "/prefix" + std::to_string(prefix);
+        for (const BenchResult& r : results) entries.push_back({"string", label, 0, r});
+    }
+}
+
+// Writes n int64 keys of the given pattern, generated in chunks that fit
+// the memory budget (each chunk is an independent instance of the pattern).
+static bool write_key_file(const std::string& path, DataPattern pattern, uint64_t n, size_t chunkKeys,
+                           uint64_t& digest) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    digest = 0;
+    bool ok = true;
+    for (uint64_t done = 0, chunk = 0; ok && done < n; ++chunk) {
+        DataGenConfig dg;
+        dg.n = static_cast<size_t>(std::min<uint64_t>(chunkKeys, n - done));
+        dg.maxValue = 1000000000000;
+        dg.pattern = pattern;
+        dg.seed = 42 + chunk;
+        auto keys = DataGenerator(dg).generate_as<int64_t>();
+        digest += multiset_digest(keys);
+        ok = std::fwrite(keys.data(), sizeof(int64_t), keys.size(), f) == keys.size();
+        done += keys.size();
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+// External sort of an int64 key file: `file` if given (the sorted copy is
+// left next to it), otherwise a generated file of n keys per pattern. Each
+// sorter named in `sorterNames` generates the runs once.
+static int run_external(const std::vector<DataPattern>& patterns, uint64_t n, const std::string& file,
+                        const std::vector<std::string>& sorterNames, const ExternalSortConfig& cfg) {
+    std::vector<std::unique_ptr<ISorterT<int64_t>>> sorters;
+    for (auto& s : make_default_sorters<int64_t>()) {
+        for (const std::string& name : sorterNames) {
+            if (s->name() == name && !s->quadratic()) {
+                sorters.push_back(std::move(s));
+                break;
+            }
+        }
+    }
+    if (sorters.empty()) {
+        std::cerr << "no usable run sorter among --sorter names\n";
+        return 2;
+    }
+
+    const std::string dir = cfg.tempDir.empty() ? std::string(".") : cfg.tempDir;
+    const std::vector<DataPattern> inputs = file.empty() ? patterns : std::vector<DataPattern>{DataPattern::Random};
+    for (DataPattern pattern : inputs) {
+        std::string input = file;
+        uint64_t count = n, digest = 0;
+        bool sorted = false;
+        std::string error;
+        if (input.empty()) {
+            input = (std::filesystem::path(dir) / (std::string("sort_bench_") + to_string(pattern) + ".bin")).string();
+            if (!write_key_file(input, pattern, n, std::max<size_t>(1, cfg.memoryBytes / 2 / sizeof(int64_t)), digest)) {
+                std::cerr << "cannot write " << input << "\n";
+                return 1;
+            }
+        } else if (!scan_key_file(input, count, digest, sorted, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+
+        const std::string output = input + ".sorted";
+        std::vector<Report::ExternalPoint> points;
+        for (const auto& sorter : sorters) {
+            Report::ExternalPoint p;
+            p.sorter = sorter->name();
+            if (external_sort(input, output, *sorter, cfg, p.stats, p.error)) {
+                uint64_t outCount = 0, outDigest = 0;
+                p.verified = scan_key_file(output, outCount, outDigest, sorted, p.error) && sorted &&
+                             outCount == count && outDigest == digest;
+            }
+            points.push_back(p);
+        }
+        Report::printExternal(input, count * sizeof(int64_t), cfg.memoryBytes, points);
+        if (file.empty()) {
+            std::remove(input.c_str());
+            std::remove(output.c_str());
+        }
+    }
+    return 0;
+}
+
+// Sweep over a dataset file, e.g. a production dump, in place of a
+// generated input.
+template <typename T>
+static bool run_dataset(BenchmarkRunner& runner, const std::string& path, std::vector<Report::Entry>& entries) {
+    Dataset<T> data;
+    std::string error;
+    if (!data.open(path, error)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    const std::string label = "file:" + std::filesystem::path(path).filename().string();
+    std::cout << "\n=== key: " << key_name<T>() << " (" << sizeof(T) << " bytes), " << label << " ===\n";
+    runner.setSeries(label);
+    const std::vector<BenchResult> results = runner.run(data.data(), data.size(), make_default_sorters<T>());
+    Report::print(static_cast<int>(data.size()), runner.config().repeats, results);
+    for (const BenchResult& r : results) entries.push_back({key_name<T>(), label, 0, r});
+    return true;
+}
+
+static bool run_dataset(BenchmarkRunner& runner, const std::string& path, std::vector<Report::Entry>& entries) {
+    DatasetHeader h;
+    std::string error;
+    if (!read_dataset_header(path, h, error)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    const std::string key(h.key, std::find(h.key, h.key + sizeof(h.key), '\0'));
+    if (key == key_name<int32_t>()) return run_dataset<int32_t>(runner, path, entries);
+    if (key == key_name<int64_t>()) return run_dataset<int64_t>(runner, path, entries);
+    if (key == key_name<uint64_t>()) return run_dataset<uint64_t>(runner, path, entries);
+    if (key == key_name<float>()) return run_dataset<float>(runner, path, entries);
+    if (key == key_name<double>()) return run_dataset<double>(runner, path, entries);
+    if (key == key_name<Record>()) return run_dataset<Record>(runner, path, entries);
+    std::cerr << path << ": unsupported key type " << key << "\n";
+    return false;
+}
+
+template <typename T>
+static void run_mode(const std::string& mode, BenchmarkRunner& runner, const std::vector<DataPattern>& patterns,
+                     const std::vector<int>& sizes, const std::string& cacheDir, std::vector<Report::Entry>& entries) {
+    if (mode == "scaling") {
+        for (DataPattern p : patterns) run_scaling<T>(runner, p, sizes.back(), entries);
+    } else if (mode == "batches") {
+        for (DataPattern p : patterns) run_batches<T>(runner, p, sizes, entries);
+    } else if (mode == "segments") {
+        for (DataPattern p : patterns) run_segments<T>(runner, p, sizes, entries);
+    } else if (mode == "incremental") {
+        for (DataPattern p : patterns) {
+            for (int n : sizes) run_incremental<T>(p, n, entries);
+        }
+    } else if (mode == "topk") {
+        for (DataPattern p : patterns) {
+            for (int n : sizes) run_topk<T>(runner, p, n, entries);
+        }
+    } else {
+        run_sweep<T>(runner, patterns, sizes, cacheDir, entries);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<DataPattern> patterns = {DataPattern::Random};
+    std::vector<std::string> keys = {"int32"};
+    const std::vector<std::string> allKeys = {"int32", "int64", "uint64", "float", "double", "record"};
+    std::string mode = "sweep";
+    std::vector<int> sizes = {1000, 5000, 20000, 100000};
+    bool sizesGiven = false;
+    uint64_t externalKeys = 0;  // 0 = four times the memory budget
+    std::string externalFile;
+    std::vector<std::string> runSorters = {"Radix"};
+    std::vector<int> recordBytes = {8, 16, 32, 64, 128, 256};
+    ExternalSortConfig ec;
+    std::string jsonPath, csvPath, baselinePath;
+    std::string cacheDir;
+    std::vector<std::string> datasets;
+    double regressThreshold = 0.10;
+
+    BenchConfig bc;
+    bc.repeats = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* v = nullptr;
+        if ((v = flag_value(argv[i], "--cpu"))) bc.pinCpu = std::atoi(v);
+        else if ((v = flag_value(argv[i], "--repeats"))) bc.repeats = std::atoi(v);
+        else if ((v = flag_value(argv[i], "--warmup"))) bc.warmup = std::atoi(v);
+        else if ((v = flag_value(argv[i], "--ci"))) bc.ciTarget = std::atof(v);
+        else if ((v = flag_value(argv[i], "--budget"))) bc.timeBudgetSec = std::atof(v);
+        else if ((v = flag_value(argv[i], "--cell-budget"))) bc.cellBudgetSec = std::atof(v);
+        else if ((v = flag_value(argv[i], "--perf"))) bc.perfCounters = std::atoi(v) != 0;
+        else if ((v = flag_value(argv[i], "--pattern"))) {
+            DataPattern p;
+            if (std::strcmp(v, "all") == 0) patterns = all_patterns();
+            else if (parse_pattern(v, p)) patterns = {p};
+            else {
+                std::cerr << "unknown pattern: " << v << "\n";
+                return 2;
+            }
+        }
+        else if ((v = flag_value(argv[i], "--mode"))) mode = v;
+        else if ((v = flag_value(argv[i], "--n"))) {
+            sizes.clear();
+            for (const char* p = v; *p;) {
+                const char* e = std::strchr(p, ',');
+                sizes.push_back(std::atoi(p));
+                p = e ? e + 1 : p + std::strlen(p);
+            }
+            sizesGiven = true;
+            externalKeys = std::strtoull(v, nullptr, 10);
+        }
+        else if ((v = flag_value(argv[i], "--bytes"))) {
+            recordBytes.clear();
+            for (const char* p = v; *p;) {
+                const char* e = std::strchr(p, ',');
+                const int bytes = std::atoi(p);
+                if (bytes < 8 || bytes > 256 || (bytes & (bytes - 1)) != 0) {
+                    std::cerr << "record bytes must be 8, 16, 32, 64, 128 or 256\n";
+                    return 2;
+                }
+                recordBytes.push_back(bytes);
+                p = e ? e + 1 : p + std::strlen(p);
+            }
+        }
+        else if ((v = flag_value(argv[i], "--cache"))) cacheDir = v;
+        else if ((v = flag_value(argv[i], "--dataset"))) {
+            for (const char* p = v; *p;) {
+                const char* e = std::strchr(p, ',');
+                datasets.emplace_back(p, e ? e : p + std::strlen(p));
+                p = e ? e + 1 : p + std::strlen(p);
+            }
+        }
+        else if ((v = flag_value(argv[i], "--mem"))) ec.memoryBytes = std::strtoull(v, nullptr, 10) << 20;
+        else if ((v = flag_value(argv[i], "--tmp"))) ec.tempDir = v;
+        else if ((v = flag_value(argv[i], "--file"))) externalFile = v;
+        else if ((v = flag_value(argv[i], "--sorter"))) {
+            runSorters.clear();
+            for (const char* p = v; *p;) {
+                const char* e = std::strchr(p, ',');
+                runSorters.emplace_back(p, e ? e : p + std::strlen(p));
+                p = e ? e + 1 : p + std::strlen(p);
+            }
+        }
+        else if ((v = flag_value(argv[i], "--json"))) jsonPath = v;
+        else if ((v = flag_value(argv[i], "--csv"))) csvPath = v;
+        else if ((v = flag_value(argv[i], "--baseline"))) baselinePath = v;
+        else if ((v = flag_value(argv[i], "--regress"))) regressThreshold = std::atof(v);
+        else if ((v = flag_value(argv[i], "--key"))) {
+            if (std::strcmp(v, "all") == 0) keys = allKeys;
+            else keys = {v};
+        }
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--mode=sweep|scaling|batches|segments|incremental|topk|records|strings|external] [--n=N[,N...]]\n"
+                      << "       [--cpu=N] [--repeats=N] [--warmup=N] [--ci=FRACTION] [--budget=SECONDS]\n"
+                      << "       [--cell-budget=SECONDS] [--perf=0|1]\n"
+                      << "       [--pattern=random|sorted|reversed|nearly-sorted|few-unique|zipf|organ-pipe|sawtooth|sorted-runs|all]\n"
+                      << "       [--key=int32|int64|uint64|float|double|record|all]\n"
+                      << "       [--json=PATH] [--csv=PATH] [--baseline=PATH.json [--regress=FRACTION]]\n"
+                      << "       sweep: [--cache=DIR] [--dataset=PATH[,PATH...]]\n"
+                      << "       records: [--bytes=8|16|32|64|128|256[,...]]\n"
+                      << "       external: [--mem=MB] [--file=PATH] [--tmp=DIR] [--sorter=NAME[,NAME...]]\n";
+            return 2;
+        }
+    }
+
+    if (mode == "external") {
+        if (externalKeys == 0) externalKeys = 4 * (ec.memoryBytes / sizeof(int64_t));
+        return run_external(patterns, externalKeys, externalFile, runSorters, ec);
+    }
+    if (mode == "argsort") mode = "records";  // the suite's earlier name
+    if (mode != "sweep" && mode != "scaling" && mode != "batches" && mode != "segments" &&
+        mode != "incremental" && mode != "topk" && mode != "records" && mode != "strings") {
+        std::cerr << "unknown mode: " << mode << "\n";
+        return 2;
+    }
+    // In batches and segments mode --n is the batch or segment size.
+    if (mode == "batches" && !sizesGiven) sizes = {16, 64, 256, 1024, 4096};
+    if (mode == "segments" && !sizesGiven) sizes = {8, 16, 32, 64, 128, 512};
+    if ((mode == "topk" || mode == "incremental" || mode == "strings") && !sizesGiven) sizes = {1000000};
+
+    // Load the baseline first so a bad path fails before the benchmarks run.
+    std::vector<Report::Entry> baseline;
+    std::string error;
+    if (!baselinePath.empty() && !Report::readJson(baselinePath, baseline, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    BenchmarkRunner runner(bc);
+    std::vector<Report::Entry> entries;
+
+    // Record rows have uint64 keys, so --key does not apply.
+    if (mode == "records") {
+        for (DataPattern p : patterns) {
+            for (int n : sizes) run_records(runner, p, n, recordBytes, entries);
+        }
+        keys.clear();
+    }
+    // Nor to string rows.
+    if (mode == "strings") {
+        for (DataPattern p : patterns) {
+            for (int n : sizes) run_strings(runner, p, n, entries);
+        }
+        keys.clear();
+    }
+    // Dataset files carry their own key type.
+    if (mode == "sweep" && !datasets.empty()) {
+        for (const std::string& path : datasets) {
+            if (!run_dataset(runner, path, entries)) return 1;
+        }
+        keys.clear();
+    }
+    for (const std::string& key : keys) {
+        if (key == "int32") run_mode<int32_t>(mode, runner, patterns, sizes, cacheDir, entries);
+        else if (key == "int64") run_mode<int64_t>(mode, runner, patterns, sizes, cacheDir, entries);
+        else if (key == "uint64") run_mode<uint64_t>(mode, runner, patterns, sizes, cacheDir, entries);
+        else if (key == "float") run_mode<float>(mode, runner, patterns, sizes, cacheDir, entries);
+        else if (key == "double") run_mode<double>(mode, runner, patterns, sizes, cacheDir, entries);
+        else if (key == "record") run_mode<Record>(mode, runner, patterns, sizes, cacheDir, entries);
+        else {
+            std::cerr << "unknown key type: " << key << "\n";
+            return 2;
+        }
+    }
+
+    if (!jsonPath.empty() || !csvPath.empty()) {
+        const Report::Metadata meta = Report::collectMetadata(runner);
+        if ((!jsonPath.empty() && !Report::writeJson(jsonPath, meta, entries, error)) ||
+            (!csvPath.empty() && !Report::writeCsv(csvPath, meta, entries, error))) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+    }
+    const int regressions = baseline.empty() ? 0 : Report::compareBaseline(baseline, entries, regressThreshold);
+    // Wrong output fails the run whether or not it was also slower.
+    size_t unverified = 0;
+    for (const Report::Entry& e : entries) unverified += !e.result.skipped && !e.result.verified;
+    if (unverified) {
+        std::cerr << unverified << " result(s) failed verification\n";
+        return 1;
     }
+    // Regressions get their own exit code so CI can tell them from errors.
+    if (regressions > 0) return 3;
 
     return 0;
-}
\ No newline at end of file
+}